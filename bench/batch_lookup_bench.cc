@@ -0,0 +1,90 @@
+// Lookup throughput of back-to-back find() calls against find_batch() and
+// lookup_batch(), which prefetch the buckets of a whole batch of keys before
+// probing any of them. The win grows with the table size once it no longer
+// fits in the last-level cache.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -I. bench/batch_lookup_bench.cc -o batch_bench
+//   ./batch_bench [num_entries] [batch_size]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "densemap/hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+template <typename MapT>
+void run(const char *Name, unsigned NumEntries, unsigned BatchSize) {
+    MapT Map(NumEntries);
+    for (unsigned i = 0; i != NumEntries; ++i) Map.try_emplace(mix(i), i);
+
+    // Half of the probes miss.
+    const unsigned NumProbes = 4 * NumEntries;
+    std::vector<Key> Probes(NumProbes);
+    for (unsigned i = 0; i != NumProbes; ++i)
+        Probes[i] = mix(mix(i) % (2 * NumEntries));
+
+    const MapT &CMap = Map;
+    uint64_t Sum = 0;
+    Clock::time_point Start = Clock::now();
+    for (unsigned i = 0; i != NumProbes; ++i) {
+        auto I = CMap.find(Probes[i]);
+        if (I != CMap.end()) Sum += I->second;
+    }
+    double Single = std::chrono::duration<double>(Clock::now() - Start).count();
+
+    std::vector<typename MapT::const_iterator> Iters(BatchSize);
+    Start = Clock::now();
+    for (unsigned i = 0; i < NumProbes; i += BatchSize) {
+        unsigned N = std::min(BatchSize, NumProbes - i);
+        CMap.find_batch(&Probes[i], N, Iters.data());
+        for (unsigned j = 0; j != N; ++j)
+            if (Iters[j] != CMap.end()) Sum += Iters[j]->second;
+    }
+    double Batch = std::chrono::duration<double>(Clock::now() - Start).count();
+
+    std::vector<unsigned long long> Values(BatchSize);
+    Start = Clock::now();
+    for (unsigned i = 0; i < NumProbes; i += BatchSize) {
+        unsigned N = std::min(BatchSize, NumProbes - i);
+        CMap.lookup_batch(&Probes[i], N, Values.data());
+        for (unsigned j = 0; j != N; ++j) Sum += Values[j];
+    }
+    double Lookup =
+        std::chrono::duration<double>(Clock::now() - Start).count();
+
+    std::printf("%-18s find %6.1fns  find_batch %6.1fns  lookup_batch "
+                "%6.1fns  (speedup %.2fx)  [%llu]\n",
+                Name, Single * 1e9 / NumProbes, Batch * 1e9 / NumProbes,
+                Lookup * 1e9 / NumProbes, Single / Batch,
+                static_cast<unsigned long long>(Sum));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumEntries = argc > 1 ? std::atoi(argv[1]) : 8000000;
+    unsigned BatchSize = argc > 2 ? std::atoi(argv[2]) : 256;
+    if (NumEntries == 0 || BatchSize == 0) return 1;
+    std::printf("%u entries of uint64_t -> uint64_t, batches of %u\n",
+                NumEntries, BatchSize);
+    run<HashMap<Key, Key>>("QuadraticProbing", NumEntries, BatchSize);
+    run<HashMap<Key, Key, HashMapInfo<Key>, detail::HashMapPair<Key, Key>,
+                SwissGroupProbing>>("SwissGroupProbing", NumEntries,
+                                    BatchSize);
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Time of building a HashMap from a vector of pairs with try_emplace() in a
+// loop, and with build_parallel() on 1 to max_threads threads. A quarter of
+// the keys occur twice, so the duplicate policy has work to do. The last
+// runs build into a map full of tombstones left by erasing other keys.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -pthread -I. bench/build_parallel_bench.cc
+//   ./a.out [num_entries] [max_threads]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "densemap/hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+double seconds(Clock::time_point Start) {
+    return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+template <typename ProbeT>
+void run(const char *Name, const std::vector<std::pair<Key, Key>> &Input,
+         unsigned MaxThreads) {
+    using MapT =
+        HashMap<Key, Key, HashMapInfo<Key>, detail::HashMapPair<Key, Key>,
+                ProbeT>;
+    uint64_t Sum = 0;
+    {
+        Clock::time_point Start = Clock::now();
+        MapT Map;
+        for (const std::pair<Key, Key> &KV : Input)
+            Map.try_emplace(KV.first, KV.second);
+        std::printf("%s: try_emplace loop %.1fms\n", Name,
+                    seconds(Start) * 1e3);
+        Sum += Map.size();
+    }
+    {
+        Clock::time_point Start = Clock::now();
+        MapT Map;
+        Map.reserve(Input.size());
+        for (const std::pair<Key, Key> &KV : Input)
+            Map.try_emplace(KV.first, KV.second);
+        std::printf("%s: reserve + try_emplace loop %.1fms\n", Name,
+                    seconds(Start) * 1e3);
+        Sum += Map.size();
+    }
+    for (unsigned Threads = 1; Threads <= MaxThreads; Threads *= 2) {
+        Clock::time_point Start = Clock::now();
+        MapT Map;
+        Map.build_parallel(Input.begin(), Input.end(), Threads,
+                           DuplicatePolicy::LastWins);
+        std::printf("%s: build_parallel, %u threads %.1fms\n", Name, Threads,
+                    seconds(Start) * 1e3);
+        Sum += Map.size();
+    }
+    // A map whose entries were all erased: every bucket they held is a
+    // tombstone, which the parallel regions must not be left to fill up.
+    for (unsigned Threads = 1; Threads <= MaxThreads; Threads *= 2) {
+        MapT Map;
+        for (const std::pair<Key, Key> &KV : Input)
+            Map.try_emplace(~KV.first & ~(3ULL << 62), KV.second);
+        for (const std::pair<Key, Key> &KV : Input)
+            Map.erase(~KV.first & ~(3ULL << 62));
+        Clock::time_point Start = Clock::now();
+        Map.build_parallel(Input.begin(), Input.end(), Threads,
+                           DuplicatePolicy::LastWins);
+        std::printf("%s: build_parallel after erasing, %u threads %.1fms\n",
+                    Name, Threads, seconds(Start) * 1e3);
+        Sum += Map.size();
+    }
+    std::printf("[%llu]\n", static_cast<unsigned long long>(Sum));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumEntries = argc > 1 ? std::atoi(argv[1]) : 4000000;
+    unsigned MaxThreads = argc > 2 ? std::atoi(argv[2])
+                                   : std::thread::hardware_concurrency();
+    if (NumEntries == 0) return 1;
+    if (MaxThreads == 0) MaxThreads = 1;
+
+    std::vector<std::pair<Key, Key>> Input;
+    Input.reserve(NumEntries);
+    for (unsigned i = 0; i != NumEntries; ++i)
+        Input.emplace_back(mix(i % (NumEntries - NumEntries / 4)), i);
+
+    std::printf("%u pairs of uint64_t -> uint64_t, %u hardware threads\n",
+                NumEntries, std::thread::hardware_concurrency());
+    run<QuadraticProbing>("QuadraticProbing", Input, MaxThreads);
+    run<SwissGroupProbing>("SwissGroupProbing", Input, MaxThreads);
+    return 0;
+}
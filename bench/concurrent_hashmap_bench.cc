@@ -0,0 +1,116 @@
+// Throughput of ConcurrentHashMap against a HashMap behind a single mutex as
+// the number of threads grows. Each thread runs a mix of 50% finds, 25%
+// inserts, 15% updates and 10% erases over its own slice of the key space.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -pthread -I. bench/concurrent_hashmap_bench.cc -o cb
+//   ./cb [max_threads] [ops_per_thread]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "densemap/concurrent_hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+/// The baseline: one HashMap, one lock.
+class GlobalLockMap {
+    mutable std::mutex Lock;
+    HashMap<Key, Key> Map;
+
+public:
+    bool find(Key K, Key &V) const {
+        std::lock_guard<std::mutex> Guard(Lock);
+        auto I = Map.find(K);
+        if (I == Map.end()) return false;
+        V = I->second;
+        return true;
+    }
+    bool try_emplace(Key K, Key V) {
+        std::lock_guard<std::mutex> Guard(Lock);
+        return Map.try_emplace(K, V).second;
+    }
+    template <typename FnT>
+    bool update(Key K, FnT Fn) {
+        std::lock_guard<std::mutex> Guard(Lock);
+        auto I = Map.find(K);
+        if (I == Map.end()) return false;
+        Fn(I->second);
+        return true;
+    }
+    bool erase(Key K) {
+        std::lock_guard<std::mutex> Guard(Lock);
+        return Map.erase(K);
+    }
+};
+
+template <typename MapT>
+void worker(MapT &Map, unsigned Thread, unsigned NumOps, uint64_t &Sink) {
+    const uint64_t Base = uint64_t(Thread) << 32;
+    uint64_t State = Base | 1;
+    uint64_t Sum = 0;
+    for (unsigned i = 0; i != NumOps; ++i) {
+        State = State * 6364136223846793005ULL + 1442695040888963407ULL;
+        const unsigned Op = (State >> 33) % 100;
+        const Key K = mix(Base + (State >> 40) % (1 << 16));
+        Key V;
+        if (Op < 50) {
+            if (Map.find(K, V)) Sum += V;
+        } else if (Op < 75) {
+            Map.try_emplace(K, i);
+        } else if (Op < 90) {
+            Map.update(K, [](Key &Val) { ++Val; });
+        } else {
+            Map.erase(K);
+        }
+    }
+    Sink = Sum;
+}
+
+template <typename MapT>
+double run(unsigned NumThreads, unsigned OpsPerThread) {
+    MapT Map;
+    std::vector<std::thread> Threads;
+    std::vector<uint64_t> Sinks(NumThreads);
+    Clock::time_point Start = Clock::now();
+    for (unsigned t = 0; t != NumThreads; ++t)
+        Threads.emplace_back(worker<MapT>, std::ref(Map), t, OpsPerThread,
+                             std::ref(Sinks[t]));
+    for (std::thread &T : Threads) T.join();
+    double Secs = std::chrono::duration<double>(Clock::now() - Start).count();
+    return double(NumThreads) * OpsPerThread / Secs / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned MaxThreads =
+        argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+    unsigned OpsPerThread = argc > 2 ? std::atoi(argv[2]) : 2000000;
+    if (MaxThreads == 0 || OpsPerThread == 0) return 1;
+    std::printf("%-8s %18s %22s\n", "threads", "global lock Mops/s",
+                "ConcurrentHashMap Mops/s");
+    std::vector<unsigned> Counts;
+    for (unsigned T = 1; T < MaxThreads; T *= 2) Counts.push_back(T);
+    Counts.push_back(MaxThreads);
+    for (unsigned T : Counts) {
+        double Global = run<GlobalLockMap>(T, OpsPerThread);
+        double Sharded = run<ConcurrentHashMap<Key, Key>>(T, OpsPerThread);
+        std::printf("%-8u %18.1f %22.1f\n", T, Global, Sharded);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Lookup time of a CuckooHashMap as its table fills up, next to a HashMap
+// holding the same keys. The cuckoo table is reserved up front and filled
+// to each load in turn without growing; HashMap keeps its own load below
+// 3/4.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -I. bench/cuckoo_hashmap_bench.cc -o cuckoo_bench
+//   ./cuckoo_bench [num_buckets]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "densemap/cuckoo_hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+double seconds(Clock::time_point Start) {
+    return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+template <typename MapT>
+double run(const MapT &Map, const std::vector<Key> &Probes, uint64_t &Sum) {
+    Clock::time_point Start = Clock::now();
+    for (Key K : Probes) Sum += Map.lookup(K);
+    return seconds(Start) * 1e9 / Probes.size();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumBuckets = argc > 1 ? std::atoi(argv[1]) : 1U << 20;
+    if (NumBuckets == 0 || (NumBuckets & (NumBuckets - 1)) != 0) return 1;
+    using CuckooT = CuckooHashMap<Key, Key>;
+    const unsigned NumSlots = NumBuckets * CuckooT::SlotsPerBucket;
+    CuckooT Cuckoo(NumSlots / 16 * CuckooT::MaxLoadNumerator);
+    if (Cuckoo.getNumBuckets() != NumBuckets) return 1;
+    HashMap<Key, Key> Map;
+
+    std::printf("%u buckets of %u uint64_t -> uint64_t entries\n", NumBuckets,
+                CuckooT::SlotsPerBucket);
+    std::printf(
+        "load   insert ns   cuckoo hit/miss ns   HashMap hit/miss ns\n");
+    const double Loads[] = {0.5, 0.7, 0.8, 0.9, 0.93};
+    unsigned Next = 0;
+    uint64_t Sum = 0;
+    for (double Load : Loads) {
+        const unsigned Target = static_cast<unsigned>(Load * NumSlots);
+        const unsigned First = Next;
+        Clock::time_point Start = Clock::now();
+        for (; Next != Target; ++Next) Cuckoo.try_emplace(mix(Next), Next);
+        const double InsertNs = seconds(Start) * 1e9 / (Next - First);
+        for (unsigned i = First; i != Next; ++i) Map.try_emplace(mix(i), i);
+
+        // Half of the probes miss.
+        std::vector<Key> Hits(Next / 2), Misses(Next / 2);
+        for (unsigned i = 0; i != Hits.size(); ++i) {
+            Hits[i] = mix(mix(i) % Next);
+            Misses[i] = mix(Next + mix(i) % Next);
+        }
+        const double CuckooHit = run(Cuckoo, Hits, Sum);
+        const double CuckooMiss = run(Cuckoo, Misses, Sum);
+        const double MapHit = run(Map, Hits, Sum);
+        const double MapMiss = run(Map, Misses, Sum);
+        std::printf("%.2f   %9.1f   %8.1f / %6.1f      %8.1f / %6.1f\n",
+                    double(Cuckoo.size()) / NumSlots, InsertNs, CuckooHit,
+                    CuckooMiss, MapHit, MapMiss);
+    }
+    std::printf("cuckoo %.1f MB, HashMap %.1f MB [%llu]\n",
+                Cuckoo.getMemorySize() / 1048576.0,
+                Map.getMemorySize() / 1048576.0,
+                static_cast<unsigned long long>(Sum));
+    return Cuckoo.getNumBuckets() == NumBuckets ? 0 : 1;
+}
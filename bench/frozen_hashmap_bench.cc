@@ -0,0 +1,66 @@
+// Memory and lookup time of a FrozenHashMap against the HashMap it was built
+// from, plus the time the perfect hash takes to build.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -I. bench/frozen_hashmap_bench.cc -o frozen_bench
+//   ./frozen_bench [num_entries]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "densemap/frozen_hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+double seconds(Clock::time_point Start) {
+    return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+template <typename MapT>
+double run(const MapT &Map, const std::vector<Key> &Probes, uint64_t &Sum) {
+    Clock::time_point Start = Clock::now();
+    for (Key K : Probes) Sum += Map.lookup(K);
+    return seconds(Start) * 1e9 / Probes.size();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumEntries = argc > 1 ? std::atoi(argv[1]) : 4000000;
+    if (NumEntries == 0) return 1;
+    HashMap<Key, Key> Map;
+    for (unsigned i = 0; i != NumEntries; ++i) Map.try_emplace(mix(i), i);
+
+    Clock::time_point Start = Clock::now();
+    FrozenHashMap<Key, Key> Frozen(Map);
+    double BuildSecs = seconds(Start);
+
+    // Half of the probes miss.
+    std::vector<Key> Probes(4 * size_t(NumEntries));
+    for (size_t i = 0; i != Probes.size(); ++i)
+        Probes[i] = mix(mix(i) % (2 * NumEntries));
+
+    uint64_t Sum = 0;
+    double MapNs = run(Map, Probes, Sum);
+    double FrozenNs = run(Frozen, Probes, Sum);
+    std::printf("%u entries of uint64_t -> uint64_t, built in %.2fs\n",
+                NumEntries, BuildSecs);
+    std::printf("HashMap        %8.1f MB  %6.1fns/lookup\n",
+                Map.getMemorySize() / 1048576.0, MapNs);
+    std::printf("FrozenHashMap  %8.1f MB  %6.1fns/lookup  [%llu]\n",
+                Frozen.getMemorySize() / 1048576.0, FrozenNs,
+                static_cast<unsigned long long>(Sum));
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Random lookups into a multi-GB HashMap whose bucket array is backed by 4K
+// pages, by transparent huge pages and by explicit 2MB pages. Once the table
+// is far larger than the TLB reach of 4K pages nearly every lookup takes a
+// TLB miss and a page walk, which huge pages mostly avoid. Explicit pages
+// need a hugetlbfs pool (vm.nr_hugepages), without one they fall back to
+// transparent huge pages.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -I. bench/huge_page_bench.cc -o huge_page_bench
+//   ./huge_page_bench [num_entries] [num_lookups]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "common/huge_page_allocator.h"
+#include "densemap/hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+using BucketT = detail::HashMapPair<Key, Key>;
+using MapT = HashMap<Key, Key, HashMapInfo<Key>, BucketT, QuadraticProbing,
+                     HugePageAllocator<BucketT>>;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+/// The AnonHugePages line of /proc/self/smaps_rollup, in MB, or -1.
+long getAnonHugePagesMB() {
+    std::FILE *F = std::fopen("/proc/self/smaps_rollup", "r");
+    if (!F) return -1;
+    char Line[256];
+    long KB = -1;
+    while (std::fgets(Line, sizeof(Line), F))
+        if (std::sscanf(Line, "AnonHugePages: %ld kB", &KB) == 1) break;
+    std::fclose(F);
+    return KB < 0 ? -1 : KB / 1024;
+}
+
+void run(const char *Name, PageMode Mode, unsigned NumEntries,
+         unsigned NumLookups) {
+    MapT Map(NumEntries, MapT::allocator_type(Mode));
+    for (unsigned i = 0; i != NumEntries; ++i) Map.try_emplace(mix(i), i);
+    const long HugeMB = getAnonHugePagesMB();
+
+    // Every lookup hits, at a random place in the table.
+    const MapT &CMap = Map;
+    uint64_t Sum = 0;
+    Clock::time_point Start = Clock::now();
+    for (unsigned i = 0; i != NumLookups; ++i) {
+        auto I = CMap.find(mix(mix(i) % NumEntries));
+        Sum += I->second;
+    }
+    double Secs = std::chrono::duration<double>(Clock::now() - Start).count();
+
+    std::printf("%-12s %6zu MB table  %6ld MB on huge pages  %6.1fns/lookup"
+                "  [%llu]\n",
+                Name, Map.getMemorySize() >> 20, HugeMB,
+                Secs * 1e9 / NumLookups, static_cast<unsigned long long>(Sum));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    // 80M entries fill 2^27 buckets of 16 bytes, a 2GB table.
+    unsigned NumEntries = argc > 1 ? std::atoi(argv[1]) : 80000000;
+    unsigned NumLookups = argc > 2 ? std::atoi(argv[2]) : 20000000;
+    if (NumEntries == 0 || NumLookups == 0) return 1;
+    std::printf("%u entries of uint64_t -> uint64_t, %u random lookups\n",
+                NumEntries, NumLookups);
+    run("4K pages", PageMode::Small, NumEntries, NumLookups);
+    run("THP", PageMode::Transparent, NumEntries, NumLookups);
+    run("2MB pages", PageMode::Huge2MB, NumEntries, NumLookups);
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Worst-case insert latency of HashMap, whose Grow() rehashes the whole table
+// in one call, against IncrementalHashMap, which spreads the rehash over the
+// operations that follow it.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -I. bench/incremental_rehash_bench.cc -o rehash_bench
+//   ./rehash_bench [num_inserts]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "densemap/incremental_hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+template <typename MapT>
+void run(const char *Name, unsigned NumInserts) {
+    std::vector<uint32_t> Latency(NumInserts);
+    MapT Map;
+    Clock::time_point Start = Clock::now();
+    for (unsigned i = 0; i != NumInserts; ++i) {
+        Clock::time_point T0 = Clock::now();
+        Map.try_emplace(mix(i), i);
+        Clock::time_point T1 = Clock::now();
+        Latency[i] = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(T1 - T0)
+                .count());
+    }
+    double Total = std::chrono::duration<double>(Clock::now() - Start).count();
+
+    std::sort(Latency.begin(), Latency.end());
+    auto pct = [&](double P) {
+        return Latency[std::min<size_t>(NumInserts - 1,
+                                        size_t(P * NumInserts))];
+    };
+    std::printf("%-20s total %7.3fs  p50 %6uns  p99 %6uns  p99.99 %9uns  "
+                "max %10uns\n",
+                Name, Total, pct(0.5), pct(0.99), pct(0.9999),
+                Latency.back());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumInserts = argc > 1 ? std::atoi(argv[1]) : 10000000;
+    if (NumInserts == 0) return 1;
+    std::printf("%u inserts of uint64_t -> uint64_t\n", NumInserts);
+    run<HashMap<unsigned long long, unsigned long long>>("HashMap", NumInserts);
+    run<IncrementalHashMap<unsigned long long, unsigned long long>>(
+        "IncrementalHashMap", NumInserts);
+    return 0;
+}
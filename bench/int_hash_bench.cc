@@ -0,0 +1,120 @@
+// Probe lengths and timings of HashMap with integer keys under the mixers of
+// hashmap_info.h, on key distributions that defeat a weak hash: sequential
+// ids, page-aligned addresses, ids shifted into the high half, millisecond
+// timestamps in nanoseconds, and random keys. A run that has not finished
+// inserting after a few seconds is abandoned and reported as such.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -I. bench/int_hash_bench.cc -o int_hash_bench
+//   ./int_hash_bench [num_entries]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "densemap/hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+
+constexpr double GiveUpSeconds = 5;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+double seconds(Clock::time_point Start) {
+    return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+Key sequential(uint64_t i) { return i; }
+Key pageAligned(uint64_t i) { return 0x7f0000000000ULL + (i << 12); }
+Key highHalf(uint64_t i) { return i << 32; }
+Key timestamps(uint64_t i) { return 1700000000000000000ULL + i * 1000000; }
+Key randomKeys(uint64_t i) { return mix(i); }
+
+struct Distribution {
+    const char *Name;
+    Key (*Make)(uint64_t);
+};
+
+const Distribution Distributions[] = {
+    {"sequential", sequential}, {"page-aligned", pageAligned},
+    {"high-half", highHalf},    {"timestamps", timestamps},
+    {"random", randomKeys},
+};
+
+/// The number of buckets a QuadraticProbing lookup of Val visits.
+template <typename KeyInfoT>
+unsigned countProbes(const detail::HashMapPair<Key, Key> *Buckets, unsigned N,
+                     Key Val) {
+    unsigned BucketNo = KeyInfoT::GetHashValue(Val) & (N - 1);
+    for (unsigned Probes = 1;; ++Probes) {
+        const Key K = Buckets[BucketNo].GetFirst();
+        if (K == Val || K == KeyInfoT::GetEmptyKey()) return Probes;
+        BucketNo = (BucketNo + Probes) & (N - 1);
+    }
+}
+
+template <typename MixT>
+void run(const char *Name, const Distribution &Dist, unsigned NumEntries) {
+    using KeyInfo = MixedHashMapInfo<Key, MixT>;
+    using Bucket = detail::HashMapPair<Key, Key>;
+    HashMap<Key, Key, KeyInfo, Bucket> Map;
+    std::vector<Key> Keys(NumEntries);
+    for (unsigned i = 0; i != NumEntries; ++i) Keys[i] = Dist.Make(i);
+
+    Clock::time_point Start = Clock::now();
+    for (unsigned i = 0; i != NumEntries; ++i) {
+        Map.try_emplace(Keys[i], i);
+        if (i % 1024 == 0 && seconds(Start) > GiveUpSeconds) {
+            std::printf("  %-14s gave up after %u keys in %.0fs\n", Name, i,
+                        GiveUpSeconds);
+            return;
+        }
+    }
+    const double InsertNs = seconds(Start) * 1e9 / NumEntries;
+
+    uint64_t Sum = 0;
+    Start = Clock::now();
+    for (Key K : Keys) Sum += Map.lookup(K);
+    const double HitNs = seconds(Start) * 1e9 / NumEntries;
+
+    const unsigned N = Map.getNumBuckets();
+    const Bucket *Buckets =
+        static_cast<const Bucket *>(Map.getPointerIntoBucketsArray());
+    uint64_t Probes = 0;
+    unsigned MaxProbes = 0;
+    for (Key K : Keys) {
+        const unsigned P = countProbes<KeyInfo>(Buckets, N, K);
+        Probes += P;
+        MaxProbes = std::max(MaxProbes, P);
+    }
+    std::printf("  %-14s insert %6.1fns  hit %6.1fns  probes mean %6.2f "
+                "max %6u [%llu]\n",
+                Name, InsertNs, HitNs, double(Probes) / NumEntries, MaxProbes,
+                static_cast<unsigned long long>(Sum));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumEntries = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    if (NumEntries == 0) return 1;
+    std::printf("%u entries of uint64_t -> uint64_t, QuadraticProbing\n",
+                NumEntries);
+    for (const Distribution &Dist : Distributions) {
+        std::printf("%s:\n", Dist.Name);
+        run<Multiply37Mix>("Multiply37Mix", Dist, NumEntries);
+        run<FibonacciMix>("FibonacciMix", Dist, NumEntries);
+        run<HashIntegerMix>("HashIntegerMix", Dist, NumEntries);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Iteration and clear() timings of HashMap with and without an
+// OccupancyBitmap, for tables that keep 1% to 100% of their entries after
+// an erase phase. Iterating without the bitmap compares the key of every
+// bucket against the empty and tombstone keys; with it, the iterator jumps
+// from one set bit to the next.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -I. bench/occupancy_bitmap_bench.cc
+//   ./a.out [num_entries]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "densemap/hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+double seconds(Clock::time_point Start) {
+    return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+template <typename MapT>
+void run(const char *Name, unsigned NumEntries, unsigned PercentKept) {
+    MapT Map;
+    for (unsigned i = 0; i != NumEntries; ++i)
+        Map.try_emplace(mix(i), std::to_string(i));
+    for (unsigned i = 0; i != NumEntries; ++i)
+        if (i % 100 >= PercentKept) Map.erase(mix(i));
+
+    uint64_t Sum = 0;
+    constexpr unsigned Rounds = 10;
+    Clock::time_point Start = Clock::now();
+    for (unsigned Round = 0; Round != Rounds; ++Round)
+        for (const auto &KV : Map) Sum += KV.second.size();
+    const double IterateMs = seconds(Start) * 1e3 / Rounds;
+
+    Map.compact();  // Lets clear() skip dead regions with the bitmap.
+    Start = Clock::now();
+    Map.clear();
+    const double ClearMs = seconds(Start) * 1e3;
+
+    std::printf("  %-34s iterate %7.3fms  clear %7.3fms [%llu]\n", Name,
+                IterateMs, ClearMs, static_cast<unsigned long long>(Sum));
+}
+
+template <typename ProbeT>
+void runBoth(const char *Name, const char *BitmapName, unsigned NumEntries,
+             unsigned PercentKept) {
+    using Bucket = detail::HashMapPair<Key, std::string>;
+    run<HashMap<Key, std::string, HashMapInfo<Key>, Bucket, ProbeT>>(
+        Name, NumEntries, PercentKept);
+    run<HashMap<Key, std::string, HashMapInfo<Key>, Bucket,
+                OccupancyBitmap<ProbeT>>>(BitmapName, NumEntries,
+                                          PercentKept);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumEntries = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    if (NumEntries == 0) return 1;
+    std::printf("%u entries of uint64_t -> std::string\n", NumEntries);
+    for (unsigned PercentKept : {1, 5, 25, 100}) {
+        std::printf("%u%% kept:\n", PercentKept);
+        runBoth<QuadraticProbing>("QuadraticProbing",
+                                  "OccupancyBitmap<QuadraticProbing>",
+                                  NumEntries, PercentKept);
+        runBoth<SwissGroupProbing>("SwissGroupProbing",
+                                   "OccupancyBitmap<SwissGroupProbing>",
+                                   NumEntries, PercentKept);
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Rehash throughput of HashMap::Grow() with setGrowThreads() at 1 to
+// max_threads threads: a map of num_entries entries is filled up to just
+// below its load limit and then grown to twice its size with reserve(),
+// which is timed alone. Repeated for QuadraticProbing and SwissGroupProbing.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -pthread -I. bench/parallel_grow_bench.cc
+//   ./a.out [num_entries] [max_threads]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "densemap/hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+double seconds(Clock::time_point Start) {
+    return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+template <typename ProbeT>
+void run(const char *Name, unsigned NumEntries, unsigned MaxThreads) {
+    using MapT =
+        HashMap<Key, Key, HashMapInfo<Key>, detail::HashMapPair<Key, Key>,
+                ProbeT>;
+    for (unsigned Threads = 1; Threads <= MaxThreads; Threads *= 2) {
+        MapT Map(NumEntries);
+        for (unsigned i = 0; i != NumEntries; ++i) Map.try_emplace(mix(i), i);
+        const unsigned OldNumBuckets = Map.getNumBuckets();
+
+        Map.setGrowThreads(Threads);
+        Clock::time_point Start = Clock::now();
+        Map.reserve(OldNumBuckets);
+        const double Secs = seconds(Start);
+        std::printf("%s: %u threads, %u -> %u buckets in %.1fms, "
+                    "%.1fM entries/s\n",
+                    Name, Threads, OldNumBuckets, Map.getNumBuckets(),
+                    Secs * 1e3, NumEntries / Secs / 1e6);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumEntries = argc > 1 ? std::atoi(argv[1]) : 12000000;
+    unsigned MaxThreads = argc > 2 ? std::atoi(argv[2])
+                                   : std::thread::hardware_concurrency();
+    if (NumEntries == 0) return 1;
+    if (MaxThreads == 0) MaxThreads = 1;
+    std::printf("%u entries of uint64_t -> uint64_t, %u hardware threads\n",
+                NumEntries, std::thread::hardware_concurrency());
+    run<QuadraticProbing>("QuadraticProbing", NumEntries, MaxThreads);
+    run<SwissGroupProbing>("SwissGroupProbing", NumEntries, MaxThreads);
+    return 0;
+}
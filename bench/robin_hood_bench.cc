@@ -0,0 +1,166 @@
+// Probe lengths of HashMap under QuadraticProbing and RobinHoodProbing on a
+// delete-heavy workload: the table is filled, then keys are erased and new
+// ones inserted until it has turned over several times. Prints the
+// distribution of buckets visited by successful and unsuccessful lookups,
+// and the time of the churn and of the lookups.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -I. bench/robin_hood_bench.cc -o robin_hood_bench
+//   ./robin_hood_bench [num_entries] [turnovers]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "densemap/hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+using KeyInfo = HashMapInfo<Key>;
+using Bucket = detail::HashMapPair<Key, Key>;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+double seconds(Clock::time_point Start) {
+    return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+/// The number of buckets a lookup of Val visits, replaying the probe
+/// sequence of each policy over the raw bucket array.
+template <typename ProbeT>
+struct ProbeCounter;
+
+template <>
+struct ProbeCounter<QuadraticProbing> {
+    static unsigned count(const Bucket *Buckets, const uint8_t *, unsigned N,
+                          Key Val) {
+        unsigned BucketNo = KeyInfo::GetHashValue(Val) & (N - 1);
+        for (unsigned Probes = 1;; ++Probes) {
+            const Key K = Buckets[BucketNo].GetFirst();
+            if (K == Val || K == KeyInfo::GetEmptyKey()) return Probes;
+            BucketNo = (BucketNo + Probes) & (N - 1);
+        }
+    }
+};
+
+template <>
+struct ProbeCounter<RobinHoodProbing> {
+    static unsigned count(const Bucket *Buckets, const uint8_t *Dist,
+                          unsigned N, Key Val) {
+        unsigned BucketNo = KeyInfo::GetHashValue(Val) & (N - 1);
+        for (unsigned D = 0;; ++D, BucketNo = (BucketNo + 1) & (N - 1)) {
+            if (Dist[BucketNo] == 0 || Buckets[BucketNo].GetFirst() == Val)
+                return D + 1;
+            if (RobinHoodProbing::getDistance<KeyInfo>(Buckets, Dist, N,
+                                                       BucketNo) < D)
+                return D + 1;
+        }
+    }
+};
+
+struct Histogram {
+    static constexpr unsigned NumBins = 8;
+    static const char *binName(unsigned Bin) {
+        static const char *Names[NumBins] = {"1",    "2",     "3",     "4",
+                                             "5-8",  "9-16",  "17-32", "33+"};
+        return Names[Bin];
+    }
+
+    std::vector<unsigned> Lengths;
+
+    void print(const char *Name) {
+        std::sort(Lengths.begin(), Lengths.end());
+        uint64_t Bins[NumBins] = {}, Sum = 0;
+        for (unsigned L : Lengths) {
+            Sum += L;
+            unsigned Bin = L <= 4 ? L - 1 : L <= 8 ? 4 : L <= 16 ? 5
+                                                    : L <= 32 ? 6 : 7;
+            ++Bins[Bin];
+        }
+        const double Total = Lengths.size();
+        std::printf("  %-6s mean %5.2f  p99 %4u  max %5u |", Name,
+                    Sum / Total, Lengths[size_t(0.99 * Total)],
+                    Lengths.back());
+        for (unsigned b = 0; b != NumBins; ++b)
+            std::printf(" %s:%.1f%%", binName(b), 100.0 * Bins[b] / Total);
+        std::printf("\n");
+    }
+};
+
+template <typename ProbeT>
+void run(const char *Name, unsigned NumEntries, unsigned Turnovers) {
+    using MapT = HashMap<Key, Key, KeyInfo, Bucket, ProbeT>;
+    MapT Map;
+    std::vector<Key> Live;
+    uint64_t Next = 0;
+    for (; Next != NumEntries; ++Next) {
+        Map.try_emplace(mix(Next), Next);
+        Live.push_back(mix(Next));
+    }
+
+    // Erase a random live key and insert a fresh one, NumEntries times per
+    // turnover.
+    Clock::time_point Start = Clock::now();
+    uint64_t Rng = 88172645463325252ULL;
+    for (uint64_t i = 0; i != uint64_t(Turnovers) * NumEntries; ++i) {
+        Rng ^= Rng << 13, Rng ^= Rng >> 7, Rng ^= Rng << 17;
+        Key &Victim = Live[Rng % NumEntries];
+        Map.erase(Victim);
+        Victim = mix(Next++);
+        Map.try_emplace(Victim, i);
+    }
+    const double ChurnNs = seconds(Start) * 1e9 / (uint64_t(Turnovers) *
+                                                   NumEntries);
+
+    std::vector<Key> Misses(NumEntries);
+    for (unsigned i = 0; i != NumEntries; ++i) Misses[i] = mix(Next + i);
+
+    uint64_t Sum = 0;
+    Start = Clock::now();
+    for (Key K : Live) Sum += Map.lookup(K);
+    const double HitNs = seconds(Start) * 1e9 / NumEntries;
+    Start = Clock::now();
+    for (Key K : Misses) Sum += Map.count(K);
+    const double MissNs = seconds(Start) * 1e9 / NumEntries;
+
+    const unsigned N = Map.getNumBuckets();
+    const Bucket *Buckets =
+        static_cast<const Bucket *>(Map.getPointerIntoBucketsArray());
+    const uint8_t *Meta = reinterpret_cast<const uint8_t *>(Buckets + N);
+    Histogram HitLengths, MissLengths;
+    for (Key K : Live)
+        HitLengths.Lengths.push_back(
+            ProbeCounter<ProbeT>::count(Buckets, Meta, N, K));
+    for (Key K : Misses)
+        MissLengths.Lengths.push_back(
+            ProbeCounter<ProbeT>::count(Buckets, Meta, N, K));
+
+    std::printf("%s: %u buckets, load %.2f, churn %.1fns/op, hit %.1fns, "
+                "miss %.1fns [%llu]\n",
+                Name, N, double(NumEntries) / N, ChurnNs, HitNs, MissNs,
+                static_cast<unsigned long long>(Sum));
+    HitLengths.print("hit");
+    MissLengths.print("miss");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumEntries = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    unsigned Turnovers = argc > 2 ? std::atoi(argv[2]) : 4;
+    if (NumEntries == 0) return 1;
+    std::printf("%u entries of uint64_t -> uint64_t, %u turnovers\n",
+                NumEntries, Turnovers);
+    run<QuadraticProbing>("QuadraticProbing", NumEntries, Turnovers);
+    run<RobinHoodProbing>("RobinHoodProbing", NumEntries, Turnovers);
+    return 0;
+}
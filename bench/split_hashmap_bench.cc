@@ -0,0 +1,86 @@
+// Lookup timings of HashMap against SplitHashMap with 8-byte keys and values
+// of 8, 64 and 256 bytes, for hits and for misses, under QuadraticProbing
+// and SwissGroupProbing. The keys are looked up in random order in a table
+// much larger than the caches.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++11 -I. bench/split_hashmap_bench.cc -o split_hashmap_bench
+//   ./split_hashmap_bench [num_entries]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "densemap/hashmap.h"
+#include "densemap/split_hashmap.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = unsigned long long;
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x & ~(3ULL << 62);  // Stay clear of the empty/tombstone keys.
+}
+
+double seconds(Clock::time_point Start) {
+    return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+template <unsigned Size>
+struct Value {
+    uint64_t Words[Size / 8] = {};
+    Value() = default;
+    explicit Value(uint64_t V) { Words[0] = V; }
+};
+
+template <typename MapT>
+void run(const char *Name, unsigned NumEntries) {
+    MapT Map(NumEntries);
+    for (unsigned i = 0; i != NumEntries; ++i)
+        Map.try_emplace(mix(i), typename MapT::mapped_type(i));
+
+    uint64_t Sum = 0;
+    Clock::time_point Start = Clock::now();
+    for (unsigned i = 0; i != NumEntries; ++i)
+        Sum += Map.find(mix(uint64_t(i) * 7919 % NumEntries))->second.Words[0];
+    const double HitNs = seconds(Start) * 1e9 / NumEntries;
+
+    Start = Clock::now();
+    for (unsigned i = 0; i != NumEntries; ++i)
+        Sum += Map.count(mix(uint64_t(NumEntries) + i));
+    const double MissNs = seconds(Start) * 1e9 / NumEntries;
+
+    std::printf("  %-34s hit %6.1fns  miss %6.1fns  %6.1fMB [%llu]\n", Name,
+                HitNs, MissNs, Map.getMemorySize() / 1e6,
+                static_cast<unsigned long long>(Sum));
+}
+
+template <unsigned Size>
+void runAll(unsigned NumEntries) {
+    using V = Value<Size>;
+    using Pair = detail::HashMapPair<Key, V>;
+    std::printf("uint64_t -> %u bytes:\n", Size);
+    run<HashMap<Key, V>>("HashMap", NumEntries);
+    run<SplitHashMap<Key, V>>("SplitHashMap", NumEntries);
+    run<HashMap<Key, V, HashMapInfo<Key>, Pair, SwissGroupProbing>>(
+        "HashMap, SwissGroupProbing", NumEntries);
+    run<SplitHashMap<Key, V, HashMapInfo<Key>, SwissGroupProbing>>(
+        "SplitHashMap, SwissGroupProbing", NumEntries);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned NumEntries = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    if (NumEntries == 0) return 1;
+    std::printf("%u entries\n", NumEntries);
+    runAll<8>(NumEntries);
+    runAll<64>(NumEntries);
+    runAll<256>(NumEntries);
+    return 0;
+}
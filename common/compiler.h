@@ -55,6 +55,16 @@
 #define ATTRIBUTE_NOINLINE
 #endif
 
+#if __has_builtin(__builtin_prefetch) || GNUC_PREREQ(3, 2, 0)
+#define BUILTIN_PREFETCH(addr) __builtin_prefetch(addr)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define BUILTIN_PREFETCH(addr) \
+    _mm_prefetch(reinterpret_cast<const char *>(addr), _MM_HINT_T0)
+#else
+#define BUILTIN_PREFETCH(addr) ((void)(addr))
+#endif
+
 #if !defined(NDEBUG) || defined(ENABLE_DUMP)
 #define DUMP_METHOD ATTRIBUTE_NOINLINE ATTRIBUTE_USED
 #else
@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// EpochManager - Epoch-based reclamation for data structures whose readers
+/// take no locks. A reader brackets its accesses with a ReadGuard; a writer
+/// unpublishes an object and hands it to retire(), which frees it once no
+/// reader can still be looking at it.
+///
+/// Readers announce themselves by bumping one of two counters in a slot
+/// picked by their thread, the counter chosen by the parity of the global
+/// epoch. The epoch only advances once every counter of the parity it is
+/// about to reuse has drained, and an object retired in epoch E is freed once
+/// the epoch reaches E + 2: by then every reader that could have loaded it
+/// has left. Entering and leaving are a load and two atomic adds, so readers
+/// are wait-free; only writers ever wait.
+///
+/// The epoch and every slot sit on cache lines of their own. An
+/// EpochManager created with new only gets that alignment from C++17 on.
+class EpochManager {
+    static constexpr unsigned NumSlots = 64;
+    static constexpr size_t CacheLineSize = 64;
+
+    // Readers of different threads mostly hit different slots, so they don't
+    // bounce a shared cache line.
+    struct alignas(CacheLineSize) Slot {
+        std::atomic<unsigned> Readers[2];
+    };
+
+    struct Retired {
+        void *Ptr;
+        void (*Deleter)(void *);
+        uint64_t Epoch;
+    };
+
+    // Loaded by every reader, so it stays off the lines of the slots.
+    alignas(CacheLineSize) std::atomic<uint64_t> Epoch;
+    Slot Slots[NumSlots];
+    std::mutex RetireLock;
+    std::vector<Retired> RetireList;
+
+public:
+    /// ReadGuard - Keeps every object reachable when it was constructed
+    /// alive until it is destroyed.
+    class ReadGuard {
+        std::atomic<unsigned> *Counter;
+
+    public:
+        explicit ReadGuard(EpochManager &EM) : Counter(EM.enter()) {}
+        ~ReadGuard() { Counter->fetch_sub(1, std::memory_order_release); }
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+    };
+
+    EpochManager() : Epoch(0) {
+        for (Slot &S : Slots) {
+            S.Readers[0].store(0, std::memory_order_relaxed);
+            S.Readers[1].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /// No reader may be active anymore.
+    ~EpochManager() {
+        for (Retired &R : RetireList) R.Deleter(R.Ptr);
+    }
+
+    EpochManager(const EpochManager &) = delete;
+    EpochManager &operator=(const EpochManager &) = delete;
+
+    /// retire - Delete \p Ptr once the readers that may have reached it are
+    /// gone. It must already be unreachable for new readers. Never blocks;
+    /// objects are freed by this and later calls to retire() or
+    /// synchronize().
+    template <typename T>
+    void retire(T *Ptr) {
+        std::lock_guard<std::mutex> Guard(RetireLock);
+        RetireList.push_back(Retired{Ptr, &deleteAs<T>,
+                                     Epoch.load(std::memory_order_seq_cst)});
+        // Two advances are enough to free everything retired so far.
+        if (tryAdvance()) tryAdvance();
+        reclaim();
+    }
+
+    /// synchronize - Wait for every reader active right now to leave, then
+    /// free everything retired before the call.
+    void synchronize() {
+        std::lock_guard<std::mutex> Guard(RetireLock);
+        const uint64_t Target = Epoch.load(std::memory_order_seq_cst) + 2;
+        while (Epoch.load(std::memory_order_seq_cst) < Target)
+            if (!tryAdvance()) std::this_thread::yield();
+        reclaim();
+    }
+
+private:
+    template <typename T>
+    static void deleteAs(void *Ptr) {
+        delete static_cast<T *>(Ptr);
+    }
+
+    /// Pin the current epoch for the calling thread.
+    std::atomic<unsigned> *enter() {
+        Slot &S = Slots[getThreadIndex() % NumSlots];
+        const uint64_t E = Epoch.load(std::memory_order_seq_cst);
+        std::atomic<unsigned> *Counter = &S.Readers[E & 1];
+        Counter->fetch_add(1, std::memory_order_seq_cst);
+        return Counter;
+    }
+
+    /// Move to the next epoch if no reader still uses its parity, which is
+    /// the parity of the epoch before the current one.
+    bool tryAdvance() {
+        const uint64_t E = Epoch.load(std::memory_order_seq_cst);
+        const unsigned Next = (E + 1) & 1;
+        for (Slot &S : Slots)
+            if (S.Readers[Next].load(std::memory_order_seq_cst) != 0)
+                return false;
+        Epoch.store(E + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    void reclaim() {
+        const uint64_t E = Epoch.load(std::memory_order_seq_cst);
+        size_t Kept = 0;
+        for (Retired &R : RetireList) {
+            if (R.Epoch + 2 <= E)
+                R.Deleter(R.Ptr);
+            else
+                RetireList[Kept++] = R;
+        }
+        RetireList.resize(Kept);
+    }
+
+    /// A small dense number for the calling thread.
+    static unsigned getThreadIndex() {
+        static std::atomic<unsigned> NextIndex(0);
+        thread_local unsigned Index =
+            NextIndex.fetch_add(1, std::memory_order_relaxed);
+        return Index;
+    }
+};
@@ -0,0 +1,206 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#if defined(__linux__)
+#include <sys/mman.h>
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#endif
+
+/// PageMode - How HugePageAllocator backs the memory it maps.
+enum class PageMode : uint8_t {
+    /// Ordinary 4K pages, even where transparent huge pages are enabled
+    /// system-wide.
+    Small,
+    /// 2MB-aligned mappings advised with MADV_HUGEPAGE, which the kernel
+    /// backs with transparent huge pages where it can.
+    Transparent,
+    /// Explicit 2MB or 1GB pages from the hugetlbfs pool.
+    Huge2MB,
+    Huge1GB
+};
+
+/// HugePageAllocator - A standard allocator that maps large blocks directly
+/// with mmap so that they can be backed by huge pages, which cuts the TLB
+/// misses of random accesses into a multi-GB array. Blocks smaller than
+/// MinMapSize come from operator new. Each instance carries its PageMode,
+/// so maps of the same type can use different modes.
+///
+/// A mode that can't be satisfied falls back to the next weaker one: an
+/// empty hugetlbfs pool leads to transparent huge pages, and systems
+/// without MADV_HUGEPAGE get ordinary pages. Every mapping is rounded up to
+/// the page size of the requested mode, so the length of a block follows
+/// from its size alone whichever pages ended up backing it.
+///
+/// reallocate() grows a mapped block with mremap, which moves the page
+/// tables instead of copying the contents. HashMap uses it to grow the
+/// bucket array of trivially copyable keys and values in place. On systems
+/// other than Linux the allocator always uses operator new.
+template <typename T>
+class HugePageAllocator {
+    template <typename U>
+    friend class HugePageAllocator;
+
+    PageMode Mode;
+
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    /// Blocks below this many bytes aren't worth a mapping of their own.
+    static constexpr size_t MinMapSize = size_t(1) << 21;
+
+    HugePageAllocator(PageMode M = PageMode::Transparent) : Mode(M) {}
+
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U> &Other) : Mode(Other.Mode) {}
+
+    PageMode getPageMode() const { return Mode; }
+
+    T *allocate(size_t N) {
+        const size_t Bytes = N * sizeof(T);
+#if defined(__linux__)
+        if (Bytes >= MinMapSize) {
+            if (void *P = map(getMappedLength(Bytes), Mode))
+                return static_cast<T *>(P);
+            throw std::bad_alloc();
+        }
+#endif
+        return static_cast<T *>(::operator new(Bytes));
+    }
+
+    void deallocate(T *P, size_t N) {
+#if defined(__linux__)
+        const size_t Bytes = N * sizeof(T);
+        if (Bytes >= MinMapSize) {
+            ::munmap(P, getMappedLength(Bytes));
+            return;
+        }
+#else
+        (void)N;  // silence warning.
+#endif
+        ::operator delete(P);
+    }
+
+    /// reallocate - Resize the mapped block \p P of \p OldN elements to hold
+    /// \p NewN, keeping its contents, and return its new address. Return
+    /// null, leaving \p P untouched, if the block can't be remapped; the
+    /// caller then copies into a fresh block instead.
+    T *reallocate(T *P, size_t OldN, size_t NewN) {
+        const size_t OldBytes = OldN * sizeof(T), NewBytes = NewN * sizeof(T);
+        if (OldBytes < MinMapSize || NewBytes < MinMapSize) return nullptr;
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+        const size_t OldLen = getMappedLength(OldBytes);
+        const size_t NewLen = getMappedLength(NewBytes);
+        if (OldLen == NewLen) return P;
+        if (Mode == PageMode::Small) {
+            void *R = ::mremap(P, OldLen, NewLen, MREMAP_MAYMOVE);
+            return R == MAP_FAILED ? nullptr : static_cast<T *>(R);
+        }
+#if defined(MREMAP_FIXED)
+        // Move into a reserved range aligned to the huge page size, so that
+        // the kernel can move whole huge pages and the grown part can use
+        // them too.
+        void *Dest = reserveAligned(NewLen, getPageSize(Mode));
+        if (!Dest) return nullptr;
+        void *R = ::mremap(P, OldLen, NewLen, MREMAP_MAYMOVE | MREMAP_FIXED,
+                           Dest);
+        if (R == MAP_FAILED) {
+            ::munmap(Dest, NewLen);
+            return nullptr;
+        }
+        adviseHugePages(R, NewLen);
+        return static_cast<T *>(R);
+#endif
+#endif
+        (void)P;  // silence warning.
+        return nullptr;
+    }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U> &RHS) const {
+        return Mode == RHS.Mode;
+    }
+
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U> &RHS) const {
+        return Mode != RHS.Mode;
+    }
+
+private:
+    static size_t getPageSize(PageMode M) {
+        return M == PageMode::Huge1GB
+                   ? size_t(1) << 30
+                   : M == PageMode::Small ? size_t(4096) : size_t(1) << 21;
+    }
+
+    size_t getMappedLength(size_t Bytes) const {
+        const size_t PageSize = getPageSize(Mode);
+        return (Bytes + PageSize - 1) & ~(PageSize - 1);
+    }
+
+#if defined(__linux__)
+    /// Map \p Len bytes in mode \p M, or in the next weaker mode that works.
+    void *map(size_t Len, PageMode M) const {
+        switch (M) {
+#if defined(MAP_HUGETLB)
+        case PageMode::Huge1GB:
+        case PageMode::Huge2MB: {
+            const int Shift = M == PageMode::Huge1GB ? 30 : 21;
+            void *P = ::mmap(nullptr, Len, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                                 (Shift << MAP_HUGE_SHIFT),
+                             -1, 0);
+            if (P != MAP_FAILED) return P;
+            return map(Len, PageMode::Transparent);
+        }
+#else
+        // No explicit huge pages here, settle for transparent ones.
+        case PageMode::Huge1GB:
+        case PageMode::Huge2MB:
+#endif
+        case PageMode::Transparent: {
+            void *P = reserveAligned(Len, size_t(1) << 21);
+            if (P) adviseHugePages(P, Len);
+            return P;
+        }
+        case PageMode::Small: {
+            void *P = ::mmap(nullptr, Len, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (P == MAP_FAILED) return nullptr;
+#if defined(MADV_NOHUGEPAGE)
+            ::madvise(P, Len, MADV_NOHUGEPAGE);
+#endif
+            return P;
+        }
+        }
+        return nullptr;
+    }
+
+    /// Map \p Len bytes at an address aligned to \p Align by over-mapping
+    /// and trimming both ends.
+    static void *reserveAligned(size_t Len, size_t Align) {
+        void *P = ::mmap(nullptr, Len + Align, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (P == MAP_FAILED) return nullptr;
+        const uintptr_t Begin = reinterpret_cast<uintptr_t>(P);
+        const uintptr_t Aligned = (Begin + Align - 1) & ~uintptr_t(Align - 1);
+        if (Aligned != Begin) ::munmap(P, Aligned - Begin);
+        if (const size_t Tail = Begin + Align - Aligned)
+            ::munmap(reinterpret_cast<void *>(Aligned + Len), Tail);
+        return reinterpret_cast<void *>(Aligned);
+    }
+
+    static void adviseHugePages(void *P, size_t Len) {
+#if defined(MADV_HUGEPAGE)
+        ::madvise(P, Len, MADV_HUGEPAGE);
+#else
+        (void)P, (void)Len;  // silence warning.
+#endif
+    }
+#endif
+};
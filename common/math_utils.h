@@ -1,4 +1,8 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
 namespace detail {
 template <typename T, std::size_t SizeOfT>
 struct LeadingZerosCounter {
@@ -47,6 +51,57 @@ struct LeadingZerosCounter<T, 8> {
 };
 #endif
 #endif
+
+template <typename T, std::size_t SizeOfT>
+struct TrailingZerosCounter {
+    static std::size_t count(T Val) {
+        if (!Val) return std::numeric_limits<T>::digits;
+        if (Val & 0x1) return 0;
+        // Bisection method.
+        std::size_t ZeroBits = 0;
+        T Shift = std::numeric_limits<T>::digits >> 1;
+        T Mask = std::numeric_limits<T>::max() >> Shift;
+        while (Shift) {
+            if ((Val & Mask) == 0) {
+                Val >>= Shift;
+                ZeroBits |= Shift;
+            }
+            Shift >>= 1;
+            Mask >>= Shift;
+        }
+        return ZeroBits;
+    }
+};
+#if __GNUC__ >= 4 || defined(_MSC_VER)
+template <typename T>
+struct TrailingZerosCounter<T, 4> {
+    static std::size_t count(T Val) {
+        if (Val == 0) return 32;
+#if defined(_MSC_VER)
+        unsigned long Index;
+        _BitScanForward(&Index, Val);
+        return Index;
+#else
+        return __builtin_ctz(Val);
+#endif
+    }
+};
+#if !defined(_MSC_VER) || defined(_M_X64)
+template <typename T>
+struct TrailingZerosCounter<T, 8> {
+    static std::size_t count(T Val) {
+        if (Val == 0) return 64;
+#if defined(_MSC_VER)
+        unsigned long Index;
+        _BitScanForward64(&Index, Val);
+        return Index;
+#else
+        return __builtin_ctzll(Val);
+#endif
+    }
+};
+#endif
+#endif
 }  // namespace detail
 
 inline uint64_t NextPowerOf2(uint64_t A) {
@@ -65,6 +120,15 @@ std::size_t countLeadingZeros(T Val) {
                   "Only unsigned integral types are allowed.");
     return ::detail::LeadingZerosCounter<T, sizeof(T)>::count(Val);
 }
+/// Count the number of 0's from the least significant bit upwards, returning
+/// the bit width of T when \p Val is zero.
+template <typename T>
+std::size_t countTrailingZeros(T Val) {
+    static_assert(std::numeric_limits<T>::is_integer &&
+                      !std::numeric_limits<T>::is_signed,
+                  "Only unsigned integral types are allowed.");
+    return ::detail::TrailingZerosCounter<T, sizeof(T)>::count(Val);
+}
 inline unsigned Log2_32_Ceil(uint32_t Value) {
     return 32 - countLeadingZeros(Value - 1);
 }
@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/// parallelFor - Call Fn(Task) for every Task in [0, NumTasks) on up to
+/// \p NumThreads threads, the calling thread included, and return once all
+/// of them are done. Threads take the next task as they become free, so
+/// tasks of uneven size still keep every thread busy. With one thread, or
+/// one task, everything runs on the calling thread.
+///
+/// There is no persistent pool: every call starts NumThreads - 1 new
+/// std::threads and joins them before returning, so the tasks should be
+/// large enough to pay for starting a thread.
+template <typename FnT>
+void parallelFor(unsigned NumThreads, size_t NumTasks, FnT Fn) {
+    if (NumThreads > NumTasks) NumThreads = static_cast<unsigned>(NumTasks);
+    if (NumThreads <= 1) {
+        for (size_t Task = 0; Task != NumTasks; ++Task) Fn(Task);
+        return;
+    }
+
+    std::atomic<size_t> NextTask(0);
+    auto Work = [&]() {
+        for (size_t Task; (Task = NextTask.fetch_add(1)) < NumTasks;)
+            Fn(Task);
+    };
+    std::vector<std::thread> Threads;
+    Threads.reserve(NumThreads - 1);
+    for (unsigned i = 1; i != NumThreads; ++i) Threads.emplace_back(Work);
+    Work();
+    for (std::thread &T : Threads) T.join();
+}
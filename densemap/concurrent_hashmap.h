@@ -0,0 +1,187 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "common/math_utils.h"
+#include "densemap/hashmap.h"
+
+/// ConcurrentHashMap - A HashMap that many threads can read and write at
+/// once. Keys are partitioned by the high bits of their hash into \p Shards
+/// independent HashMaps, each guarded by its own mutex, so threads only
+/// contend when they touch the same shard.
+///
+/// No reference or iterator into a shard may outlive its lock, so the API
+/// hands out copies of values instead, and update() runs a callback on the
+/// value while the shard is locked. size() and for_each() lock one shard at a
+/// time and are not a consistent snapshot while writers are running.
+///
+/// Each shard is aligned to a cache line. Before C++17, operator new ignores
+/// that alignment, so a map allocated with new may straddle cache lines.
+/// Declare it as a static or member to keep the alignment.
+template <typename KeyT, typename ValueT, unsigned Shards = 64,
+          typename KeyInfoT = HashMapInfo<KeyT>,
+          typename BucketT = detail::HashMapPair<KeyT, ValueT>,
+          typename ProbeT = QuadraticProbing>
+class ConcurrentHashMap {
+    static_assert(isPowerOf2_32(Shards), "Shards must be a power of 2.");
+
+    using MapT = HashMap<KeyT, ValueT, KeyInfoT, BucketT, ProbeT>;
+    using LockT = std::lock_guard<std::mutex>;
+
+    static constexpr size_t CacheLineSize = 64;
+
+    struct ShardData {
+        mutable std::mutex Lock;
+        MapT Map;
+    };
+
+    // Start every shard on a cache line of its own, and round its size up
+    // to whole lines, so that locking one doesn't invalidate its
+    // neighbours.
+    struct alignas(CacheLineSize) Shard : ShardData {};
+
+    Shard ShardArray[Shards];
+
+public:
+    using size_type = unsigned;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+
+    ConcurrentHashMap() = default;
+
+    /// Reserve room for \p InitialReserve entries spread evenly over the
+    /// shards.
+    explicit ConcurrentHashMap(unsigned InitialReserve) {
+        reserve(InitialReserve);
+    }
+
+    ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+    ConcurrentHashMap &operator=(const ConcurrentHashMap &) = delete;
+
+    /// Return the number of entries. Only exact if no thread is writing.
+    size_type size() const {
+        size_type Size = 0;
+        for (const Shard &S : ShardArray) {
+            LockT Guard(S.Lock);
+            Size += S.Map.size();
+        }
+        return Size;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    void reserve(size_type num_entries_) {
+        const size_type PerShard = (num_entries_ + Shards - 1) / Shards;
+        for (Shard &S : ShardArray) {
+            LockT Guard(S.Lock);
+            S.Map.reserve(PerShard);
+        }
+    }
+
+    void clear() {
+        for (Shard &S : ShardArray) {
+            LockT Guard(S.Lock);
+            S.Map.clear();
+        }
+    }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    size_type count(const KeyT &Key) const {
+        const Shard &S = getShard(Key);
+        LockT Guard(S.Lock);
+        return S.Map.count(Key);
+    }
+
+    /// find - Copy the value of \p Key into \p Value and return true, or
+    /// return false if the key isn't in the map.
+    bool find(const KeyT &Key, ValueT &Value) const {
+        const Shard &S = getShard(Key);
+        LockT Guard(S.Lock);
+        auto I = S.Map.find(Key);
+        if (I == S.Map.end()) return false;
+        Value = I->GetSecond();
+        return true;
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    ValueT lookup(const KeyT &Key) const {
+        const Shard &S = getShard(Key);
+        LockT Guard(S.Lock);
+        return S.Map.lookup(Key);
+    }
+
+    // Inserts key,value pair into the map if the key isn't already in the map.
+    // Returns false and leaves the value alone if the key is already there.
+    bool insert(const std::pair<KeyT, ValueT> &KV) {
+        return try_emplace(KV.first, KV.second);
+    }
+
+    bool insert(std::pair<KeyT, ValueT> &&KV) {
+        return try_emplace(std::move(KV.first), std::move(KV.second));
+    }
+
+    // The value is constructed in-place if the key is not in the map, otherwise
+    // it is not moved.
+    template <typename... Ts>
+    bool try_emplace(KeyT &&Key, Ts &&... Args) {
+        Shard &S = getShard(Key);
+        LockT Guard(S.Lock);
+        return S.Map.try_emplace(std::move(Key), std::forward<Ts>(Args)...)
+            .second;
+    }
+
+    template <typename... Ts>
+    bool try_emplace(const KeyT &Key, Ts &&... Args) {
+        Shard &S = getShard(Key);
+        LockT Guard(S.Lock);
+        return S.Map.try_emplace(Key, std::forward<Ts>(Args)...).second;
+    }
+
+    /// update - Call \p Fn on the value of \p Key while its shard is locked
+    /// and return true, or return false if the key isn't in the map. \p Fn
+    /// must not call back into this map.
+    template <typename FnT>
+    bool update(const KeyT &Key, FnT Fn) {
+        Shard &S = getShard(Key);
+        LockT Guard(S.Lock);
+        auto I = S.Map.find(Key);
+        if (I == S.Map.end()) return false;
+        Fn(I->GetSecond());
+        return true;
+    }
+
+    bool erase(const KeyT &Key) {
+        Shard &S = getShard(Key);
+        LockT Guard(S.Lock);
+        return S.Map.erase(Key);
+    }
+
+    /// for_each - Call \p Fn on every entry, locking one shard at a time.
+    /// \p Fn must not call back into this map.
+    template <typename FnT>
+    void for_each(FnT Fn) const {
+        for (const Shard &S : ShardArray) {
+            LockT Guard(S.Lock);
+            for (const BucketT &B : S.Map) Fn(B.GetFirst(), B.GetSecond());
+        }
+    }
+
+private:
+    /// Pick the shard from the top bits of the hash. Many HashMapInfo hashes
+    /// leave the top bits of small keys clear, so multiply by 2^32 / phi
+    /// first to fold every bit of the hash into them. This also keeps the
+    /// shard independent of the low bits the inner maps index with.
+    static unsigned getShardIndex(const KeyT &Key) {
+        const uint32_t Hash = KeyInfoT::GetHashValue(Key) * 0x9E3779B9U;
+        return static_cast<unsigned>((uint64_t(Hash) * Shards) >> 32);
+    }
+
+    Shard &getShard(const KeyT &Key) { return ShardArray[getShardIndex(Key)]; }
+
+    const Shard &getShard(const KeyT &Key) const {
+        return ShardArray[getShardIndex(Key)];
+    }
+};
@@ -0,0 +1,550 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "common/compiler.h"
+#include "common/math_utils.h"
+#include "densemap/hashing.h"
+#include "densemap/hashmap.h"
+
+/// CuckooHashMap - A map with a worst case of two bucket reads per lookup.
+/// The table is an array of buckets of SlotsPerBucket entries, and every key
+/// may only live in one of two buckets, picked by two hashes of
+/// KeyInfoT::GetHashValue: the two halves of hash_16_bytes() of it. A lookup
+/// compares the keys of those two buckets and nothing else, whether the key
+/// is in the map or not. Buckets are aligned to the cache line, so with
+/// 16-byte entries a lookup touches at most two cache lines.
+///
+/// An insertion into two full buckets evicts one of their entries to its
+/// other bucket, which may evict another, and so on for up to MaxKicks
+/// moves; if that fails, the table doubles. Four entries per bucket let the
+/// table fill up to MaxLoadNumerator/16 of its slots before it grows, and
+/// lookups cost the same at any load; insertions get slower as the table
+/// fills and eviction chains get longer.
+///
+/// Like HashMap, empty slots hold KeyInfoT::GetEmptyKey(), which can't be
+/// inserted. Erasing empties the slot, so there are no tombstones, and
+/// unlike HashMap, KeyInfoT::GetTombstoneKey() is an ordinary key. Inserting
+/// may move entries and invalidates iterators; erasing doesn't.
+template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
+          typename BucketT = detail::HashMapPair<KeyT, ValueT>>
+class CuckooHashMap {
+    template <bool IsConst>
+    class Iterator;
+
+public:
+    using size_type = unsigned;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = BucketT;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /// Entries per bucket.
+    static constexpr unsigned SlotsPerBucket = 4;
+    /// Evictions an insertion tries before growing the table.
+    static constexpr unsigned MaxKicks = 256;
+    /// The table grows before more than MaxLoadNumerator/16 of its slots
+    /// are full.
+    static constexpr unsigned MaxLoadNumerator = 15;
+
+private:
+    static constexpr size_t CacheLineSize = 64;
+    static constexpr uint64_t Seed = 0x9E3779B97F4A7C15ULL;
+
+    void *Allocation = nullptr;
+    BucketT *Slots = nullptr;
+    unsigned NumBuckets = 0;
+    unsigned NumEntries = 0;
+    /// State of the generator that picks the entries to evict.
+    uint32_t KickState = 0x2545F491;
+
+public:
+    /// Create a CuckooHashMap in which \p InitialReserve entries can be
+    /// inserted without growing it.
+    explicit CuckooHashMap(unsigned InitialReserve = 0) {
+        reserve(InitialReserve);
+    }
+
+    CuckooHashMap(const CuckooHashMap &other) { CopyFrom(other); }
+
+    CuckooHashMap(CuckooHashMap &&other) { swap(other); }
+
+    template <typename InputIt>
+    CuckooHashMap(const InputIt &I, const InputIt &E)
+        : CuckooHashMap(std::distance(I, E)) {
+        insert(I, E);
+    }
+
+    ~CuckooHashMap() { DestroyAll(); }
+
+    CuckooHashMap &operator=(const CuckooHashMap &other) {
+        if (&other != this) {
+            CuckooHashMap Tmp(other);
+            swap(Tmp);
+        }
+        return *this;
+    }
+
+    CuckooHashMap &operator=(CuckooHashMap &&other) {
+        CuckooHashMap Tmp(std::move(other));
+        swap(Tmp);
+        return *this;
+    }
+
+    void swap(CuckooHashMap &RHS) {
+        std::swap(Allocation, RHS.Allocation);
+        std::swap(Slots, RHS.Slots);
+        std::swap(NumBuckets, RHS.NumBuckets);
+        std::swap(NumEntries, RHS.NumEntries);
+        std::swap(KickState, RHS.KickState);
+    }
+
+    iterator begin() {
+        if (empty()) return end();
+        return iterator(Slots, getSlotsEnd());
+    }
+    iterator end() { return iterator(getSlotsEnd(), getSlotsEnd(), true); }
+    const_iterator begin() const {
+        if (empty()) return end();
+        return const_iterator(Slots, getSlotsEnd());
+    }
+    const_iterator end() const {
+        return const_iterator(getSlotsEnd(), getSlotsEnd(), true);
+    }
+
+    bool empty() const { return NumEntries == 0; }
+    unsigned size() const { return NumEntries; }
+
+    /// Return the number of buckets, each of SlotsPerBucket entries.
+    unsigned getNumBuckets() const { return NumBuckets; }
+
+    /// Return the size in bytes of the bucket array.
+    size_t getMemorySize() const {
+        return size_t(NumBuckets) * SlotsPerBucket * sizeof(BucketT);
+    }
+
+    void reserve(size_type NumEntries_) {
+        if (NumEntries_ == 0) return;
+        const uint64_t MinSlots =
+            (uint64_t(NumEntries_) * 16 + MaxLoadNumerator - 1) /
+            MaxLoadNumerator;
+        const uint64_t MinBuckets =
+            (MinSlots + SlotsPerBucket - 1) / SlotsPerBucket;
+        const unsigned Buckets =
+            static_cast<unsigned>(NextPowerOf2(MinBuckets - 1));
+        if (Buckets > NumBuckets) Grow(Buckets);
+    }
+
+    void clear() {
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        for (BucketT *B = Slots, *E = getSlotsEnd(); B != E; ++B) {
+            if (KeyInfoT::IsEqual(B->GetFirst(), EmptyKey)) continue;
+            B->GetSecond().~ValueT();
+            B->GetFirst() = EmptyKey;
+        }
+        NumEntries = 0;
+    }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    size_type count(const KeyT &Val) const {
+        const BucketT *the_bucket_;
+        return LookupBucketFor(Val, the_bucket_) ? 1 : 0;
+    }
+
+    iterator find(const KeyT &Val) { return find_as(Val); }
+    const_iterator find(const KeyT &Val) const { return find_as(Val); }
+
+    /// Alternate version of find() which allows a different, and possibly
+    /// less expensive, key type.
+    template <class LookupKeyT>
+    iterator find_as(const LookupKeyT &Val) {
+        const BucketT *the_bucket_;
+        if (LookupBucketFor(Val, the_bucket_))
+            return MakeIterator(const_cast<BucketT *>(the_bucket_));
+        return end();
+    }
+    template <class LookupKeyT>
+    const_iterator find_as(const LookupKeyT &Val) const {
+        const BucketT *the_bucket_;
+        if (LookupBucketFor(Val, the_bucket_))
+            return const_iterator(the_bucket_, getSlotsEnd(), true);
+        return end();
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    ValueT lookup(const KeyT &Val) const {
+        const BucketT *the_bucket_;
+        if (LookupBucketFor(Val, the_bucket_)) return the_bucket_->GetSecond();
+        return ValueT();
+    }
+
+    // Inserts key,value pair into the map if the key isn't already in the map.
+    // If the key is already in the map, it returns false and doesn't update the
+    // value.
+    std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+        return try_emplace(KV.first, KV.second);
+    }
+    std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+        return try_emplace(std::move(KV.first), std::move(KV.second));
+    }
+
+    /// insert - Range insertion of pairs.
+    template <typename InputIt>
+    void insert(InputIt I, InputIt E) {
+        for (; I != E; ++I) insert(*I);
+    }
+
+    // Inserts key,value pair into the map if the key isn't already in the map.
+    // The value is constructed in-place if the key is not in the map, otherwise
+    // it is not moved.
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+        const BucketT *the_bucket_;
+        if (LookupBucketFor(Key, the_bucket_))
+            return std::make_pair(
+                MakeIterator(const_cast<BucketT *>(the_bucket_)), false);
+        return std::make_pair(
+            MakeIterator(InsertIntoBucket(
+                std::move(Key), ValueT(std::forward<Ts>(Args)...))),
+            true);
+    }
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+        const BucketT *the_bucket_;
+        if (LookupBucketFor(Key, the_bucket_))
+            return std::make_pair(
+                MakeIterator(const_cast<BucketT *>(the_bucket_)), false);
+        return std::make_pair(
+            MakeIterator(InsertIntoBucket(KeyT(Key),
+                                          ValueT(std::forward<Ts>(Args)...))),
+            true);
+    }
+
+    ValueT &operator[](const KeyT &Key) {
+        return try_emplace(Key).first->GetSecond();
+    }
+    ValueT &operator[](KeyT &&Key) {
+        return try_emplace(std::move(Key)).first->GetSecond();
+    }
+
+    bool erase(const KeyT &Val) {
+        const BucketT *the_bucket_;
+        if (!LookupBucketFor(Val, the_bucket_)) return false;  // not in map.
+        erase(MakeIterator(const_cast<BucketT *>(the_bucket_)));
+        return true;
+    }
+    void erase(iterator I) {
+        BucketT *the_bucket_ = &*I;
+        the_bucket_->GetSecond().~ValueT();
+        the_bucket_->GetFirst() = KeyInfoT::GetEmptyKey();
+        --NumEntries;
+    }
+
+private:
+    BucketT *getSlotsEnd() { return Slots + NumBuckets * SlotsPerBucket; }
+    const BucketT *getSlotsEnd() const {
+        return Slots + NumBuckets * SlotsPerBucket;
+    }
+
+    BucketT *getBucket(unsigned BucketNo) {
+        return Slots + BucketNo * SlotsPerBucket;
+    }
+    const BucketT *getBucket(unsigned BucketNo) const {
+        return Slots + BucketNo * SlotsPerBucket;
+    }
+
+    iterator MakeIterator(BucketT *B) {
+        return iterator(B, getSlotsEnd(), true);
+    }
+
+    /// The two buckets a key may live in.
+    struct BucketPair {
+        unsigned First, Second;
+    };
+
+    template <typename LookupKeyT>
+    BucketPair getBucketPair(const LookupKeyT &Val) const {
+        const uint64_t Hash =
+            hashing::detail::hash_16_bytes(KeyInfoT::GetHashValue(Val), Seed);
+        const unsigned Mask = NumBuckets - 1;
+        return {static_cast<unsigned>(Hash) & Mask,
+                static_cast<unsigned>(Hash >> 32) & Mask};
+    }
+
+    template <typename LookupKeyT>
+    static const BucketT *FindInBucket(const BucketT *Bucket,
+                                       const LookupKeyT &Val) {
+        for (unsigned i = 0; i != SlotsPerBucket; ++i)
+            if (KeyInfoT::IsEqual(Val, Bucket[i].GetFirst())) return Bucket + i;
+        return nullptr;
+    }
+
+    static BucketT *FindEmptySlot(BucketT *Bucket) {
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        for (unsigned i = 0; i != SlotsPerBucket; ++i)
+            if (KeyInfoT::IsEqual(Bucket[i].GetFirst(), EmptyKey))
+                return Bucket + i;
+        return nullptr;
+    }
+
+    /// LookupBucketFor - Look Val up in its two buckets.
+    template <typename LookupKeyT>
+    bool LookupBucketFor(const LookupKeyT &Val,
+                         const BucketT *&FoundBucket) const {
+        if (NumBuckets == 0) {
+            FoundBucket = nullptr;
+            return false;
+        }
+        assert(!KeyInfoT::IsEqual(Val, KeyInfoT::GetEmptyKey()) &&
+               "Empty value shouldn't be inserted into map!");
+        const BucketPair Pair = getBucketPair(Val);
+        using TrivialKeys =
+            std::integral_constant<bool, isPodLike<KeyT>::value>;
+        FoundBucket = FindInBuckets(getBucket(Pair.First),
+                                    getBucket(Pair.Second), Val, TrivialKeys());
+        return FoundBucket != nullptr;
+    }
+
+    /// FindInBuckets - Trivial keys are compared in all slots of both
+    /// buckets without branching on the result, so the slot of a hit
+    /// doesn't cost a misprediction that would stall the lookups after it.
+    template <typename LookupKeyT>
+    static const BucketT *FindInBuckets(const BucketT *First,
+                                        const BucketT *Second,
+                                        const LookupKeyT &Val,
+                                        std::true_type) {
+        const BucketT *Found = nullptr;
+        for (unsigned i = 0; i != SlotsPerBucket; ++i) {
+            if (KeyInfoT::IsEqual(Val, First[i].GetFirst())) Found = First + i;
+            if (KeyInfoT::IsEqual(Val, Second[i].GetFirst()))
+                Found = Second + i;
+        }
+        return Found;
+    }
+
+    /// Other keys stop at the first match, prefetching the second bucket
+    /// while the first one is searched.
+    template <typename LookupKeyT>
+    static const BucketT *FindInBuckets(const BucketT *First,
+                                        const BucketT *Second,
+                                        const LookupKeyT &Val,
+                                        std::false_type) {
+        BUILTIN_PREFETCH(Second);
+        const BucketT *Found = FindInBucket(First, Val);
+        return Found ? Found : FindInBucket(Second, Val);
+    }
+
+    /// InsertIntoBucket - Insert a key that isn't in the map, growing it
+    /// first if it is full. Returns the slot of the new entry.
+    BucketT *InsertIntoBucket(KeyT &&Key, ValueT &&Value) {
+        if (uint64_t(NumEntries + 1) * 16 >
+            uint64_t(NumBuckets) * SlotsPerBucket * MaxLoadNumerator)
+            Grow(std::max(NumBuckets * 2, 1U));
+        BucketT *B = PlaceEntry(std::move(Key), std::move(Value));
+        ++NumEntries;
+        return B;
+    }
+
+    /// PlaceEntry - Put an entry that isn't counted in NumEntries into the
+    /// table, evicting others and growing the table as needed. Returns its
+    /// slot.
+    BucketT *PlaceEntry(KeyT &&Key, ValueT &&Value) {
+        BucketT *Placed;
+        if (KickIn(Key, Value, Placed)) return Placed;
+        // Key and Value now hold whichever entry was left without a slot.
+        // Grow the table, then place that entry; if it isn't the one being
+        // inserted, the latter is somewhere in the table already.
+        assert((uint64_t(NumEntries) * 4 >=
+                    uint64_t(NumBuckets) * SlotsPerBucket ||
+                NumBuckets < 16) &&
+               "Too many keys share a hash!");
+        if (!Placed) {
+            Grow(NumBuckets * 2);
+            return PlaceEntry(std::move(Key), std::move(Value));
+        }
+        const KeyT PlacedKey = Placed->GetFirst();
+        Grow(NumBuckets * 2);
+        PlaceEntry(std::move(Key), std::move(Value));
+        const BucketT *Found;
+        LookupBucketFor(PlacedKey, Found);
+        assert(Found && "Entry lost while growing!");
+        return const_cast<BucketT *>(Found);
+    }
+
+    /// KickIn - Try to place Key and Value, moving entries to their other
+    /// bucket to make room. Returns false if MaxKicks moves weren't enough:
+    /// Key and Value then hold the entry left over, and Placed points at
+    /// the entry that was passed in, or is null if that is the one left.
+    bool KickIn(KeyT &Key, ValueT &Value, BucketT *&Placed) {
+        bool HoldingNew = true;
+        Placed = nullptr;
+        BucketPair Pair = getBucketPair(Key);
+        // The bucket the entry in hand was evicted from, if any.
+        unsigned From = NumBuckets;
+        for (unsigned Kicks = 0;; ++Kicks) {
+            BucketT *Slot = FindEmptySlot(getBucket(Pair.First));
+            if (!Slot) Slot = FindEmptySlot(getBucket(Pair.Second));
+            if (Slot) {
+                Slot->GetFirst() = std::move(Key);
+                ::new (&Slot->GetSecond()) ValueT(std::move(Value));
+                if (HoldingNew) Placed = Slot;
+                return true;
+            }
+            if (Kicks == MaxKicks) return false;
+
+            // Evict a random entry of the bucket the entry in hand didn't
+            // come from, and carry on with it.
+            const uint32_t Random = NextRandom();
+            unsigned Victims = Pair.First == From ? Pair.Second : Pair.First;
+            if (From == NumBuckets && (Random & 1)) Victims = Pair.Second;
+            BucketT *Victim =
+                getBucket(Victims) + (Random >> 1) % SlotsPerBucket;
+            std::swap(Key, Victim->GetFirst());
+            std::swap(Value, Victim->GetSecond());
+            if (HoldingNew) {
+                Placed = Victim;
+                HoldingNew = false;
+            } else if (Victim == Placed) {
+                Placed = nullptr;
+                HoldingNew = true;
+            }
+            From = Victims;
+            Pair = getBucketPair(Key);
+        }
+    }
+
+    uint32_t NextRandom() {
+        KickState ^= KickState << 13;
+        KickState ^= KickState >> 17;
+        KickState ^= KickState << 5;
+        return KickState;
+    }
+
+    void AllocateBuckets(unsigned Num) {
+        assert(isPowerOf2_32(Num) && "# buckets must be a power of two!");
+        NumBuckets = Num;
+        const size_t Bytes = size_t(Num) * SlotsPerBucket * sizeof(BucketT);
+        Allocation = ::operator new(Bytes + CacheLineSize - 1);
+        Slots = reinterpret_cast<BucketT *>(
+            (reinterpret_cast<uintptr_t>(Allocation) + CacheLineSize - 1) &
+            ~uintptr_t(CacheLineSize - 1));
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        for (BucketT *B = Slots, *E = getSlotsEnd(); B != E; ++B)
+            ::new (&B->GetFirst()) KeyT(EmptyKey);
+    }
+
+    void DestroyAll() {
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        for (BucketT *B = Slots, *E = getSlotsEnd(); B != E; ++B) {
+            if (!KeyInfoT::IsEqual(B->GetFirst(), EmptyKey))
+                B->GetSecond().~ValueT();
+            B->GetFirst().~KeyT();
+        }
+        ::operator delete(Allocation);
+    }
+
+    void CopyFrom(const CuckooHashMap &other) {
+        if (other.NumBuckets == 0) return;
+        AllocateBuckets(other.NumBuckets);
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        for (size_t i = 0; i != size_t(NumBuckets) * SlotsPerBucket; ++i) {
+            if (KeyInfoT::IsEqual(other.Slots[i].GetFirst(), EmptyKey))
+                continue;
+            Slots[i].GetFirst() = other.Slots[i].GetFirst();
+            ::new (&Slots[i].GetSecond()) ValueT(other.Slots[i].GetSecond());
+        }
+        NumEntries = other.NumEntries;
+        KickState = other.KickState;
+    }
+
+    /// Grow - Move every entry into a new table of \p AtLeast buckets.
+    void Grow(unsigned AtLeast) {
+        CuckooHashMap Tmp;
+        Tmp.AllocateBuckets(std::max(AtLeast, NumBuckets));
+        Tmp.KickState = KickState;
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        for (BucketT *B = Slots, *E = getSlotsEnd(); B != E; ++B) {
+            if (KeyInfoT::IsEqual(B->GetFirst(), EmptyKey)) continue;
+            Tmp.PlaceEntry(std::move(B->GetFirst()),
+                           std::move(B->GetSecond()));
+            ++Tmp.NumEntries;
+            B->GetSecond().~ValueT();
+            B->GetFirst() = EmptyKey;
+        }
+        // An entry being placed may be out of the table, but is counted.
+        Tmp.NumEntries = NumEntries;
+        swap(Tmp);
+    }
+    /// Iterator - Walks the slots, skipping empty ones. Unlike
+    /// HashMapIterator it stops at a slot holding the tombstone key, which
+    /// is a key like any other here.
+    template <bool IsConst>
+    class Iterator {
+        friend class CuckooHashMap;
+        template <bool>
+        friend class Iterator;
+
+    public:
+        using difference_type = ptrdiff_t;
+        using value_type =
+            typename std::conditional<IsConst, const BucketT, BucketT>::type;
+        using pointer = value_type *;
+        using reference = value_type &;
+        using iterator_category = std::forward_iterator_tag;
+
+    private:
+        pointer Ptr = nullptr;
+        pointer End = nullptr;
+
+        Iterator(pointer Pos, pointer E, bool NoAdvance = false)
+            : Ptr(Pos), End(E) {
+            if (NoAdvance) return;
+            AdvancePastEmptySlots();
+        }
+
+    public:
+        Iterator() = default;
+
+        template <bool IsConstSrc,
+                  typename = typename std::enable_if<!IsConstSrc &&
+                                                     IsConst>::type>
+        Iterator(const Iterator<IsConstSrc> &I) : Ptr(I.Ptr), End(I.End) {}
+
+        reference operator*() const { return *Ptr; }
+        pointer operator->() const { return Ptr; }
+
+        bool operator==(const Iterator<true> &RHS) const {
+            return Ptr == RHS.Ptr;
+        }
+        bool operator!=(const Iterator<true> &RHS) const {
+            return Ptr != RHS.Ptr;
+        }
+
+        Iterator &operator++() {  // Preincrement
+            ++Ptr;
+            AdvancePastEmptySlots();
+            return *this;
+        }
+        Iterator operator++(int) {  // Postincrement
+            Iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+    private:
+        void AdvancePastEmptySlots() {
+            assert(Ptr <= End);
+            const KeyT Empty = KeyInfoT::GetEmptyKey();
+            while (Ptr != End && KeyInfoT::IsEqual(Ptr->GetFirst(), Empty))
+                ++Ptr;
+        }
+    };
+};
@@ -0,0 +1,282 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "densemap/hashing.h"
+#include "densemap/hashmap.h"
+
+namespace detail {
+
+/// Detects key types hash_value() from densemap/hashing.h accepts.
+template <typename KeyT, typename = void>
+struct HasHashValue : std::false_type {};
+
+template <typename KeyT>
+struct HasHashValue<KeyT, decltype(void(hash_value(
+                              std::declval<const KeyT &>())))>
+    : std::true_type {};
+
+}  // end namespace detail
+
+/// FrozenHashMap - An immutable map built from a populated HashMap or
+/// SmallHashMap. A minimal perfect hash sends each of the N keys to its own
+/// slot of a dense array of N entries, so the map has no empty buckets and
+/// a lookup reads one pilot word and one entry, with no probing loop.
+///
+/// The perfect hash follows CHD (hash, displace and compress): the keys are
+/// hashed into N / KeysPerPilot groups, and each group gets a 32-bit pilot.
+/// A group with several keys searches for the smallest pilot that, hashed
+/// with each of its keys, lands them all on free slots; groups are placed
+/// largest first, while the table is still mostly empty. A group with a
+/// single key just records its slot in the pilot. The pilots cost
+/// 32 / KeysPerPilot bits per key on top of the entries.
+///
+/// Keys are hashed with hash_value() from densemap/hashing.h, seeded per
+/// map, and KeyInfoT::IsEqual confirms the key found in the slot, since keys
+/// that aren't in the map land on some slot too. No seed separates keys
+/// with equal hashes, hence the 64-bit hash_value() rather than the 32-bit
+/// KeyInfoT::GetHashValue. KeyT must have a hash_value() overload, and
+/// KeyInfoT::IsEqual must agree with it: keys it finds equal must have equal
+/// hash_value(). If no seed works after MaxAttempts, two keys do share a
+/// hash and the constructor throws std::invalid_argument.
+template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>>
+class FrozenHashMap {
+    static_assert(detail::HasHashValue<KeyT>::value,
+                  "FrozenHashMap hashes its keys with hash_value()!");
+
+public:
+    using size_type = unsigned;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = detail::HashMapPair<KeyT, ValueT>;
+    using const_iterator = const value_type *;
+    using iterator = const_iterator;
+
+private:
+    using BucketT = value_type;
+
+    /// Average number of keys sharing a pilot.
+    static constexpr unsigned KeysPerPilot = 4;
+    /// Pilots with this bit set hold the slot of their only key.
+    static constexpr uint32_t DirectSlot = 1U << 31;
+    /// Pilots tried for one group before starting over with a new seed.
+    static constexpr uint32_t MaxPilot = 1U << 20;
+    static constexpr unsigned MaxAttempts = 16;
+
+    BucketT *Entries = nullptr;
+    std::unique_ptr<uint32_t[]> Pilots;
+    unsigned NumEntries = 0;
+    unsigned NumPilots = 0;
+    uint64_t Seed = 0;
+
+public:
+    FrozenHashMap() = default;
+
+    /// Build a FrozenHashMap holding a copy of every entry of \p Map, which
+    /// can be any map whose buckets provide GetFirst() and GetSecond().
+    template <typename MapT>
+    explicit FrozenHashMap(const MapT &Map) {
+        build(Map);
+    }
+
+    FrozenHashMap(FrozenHashMap &&other) { swap(other); }
+
+    FrozenHashMap &operator=(FrozenHashMap &&other) {
+        FrozenHashMap Tmp(std::move(other));
+        swap(Tmp);
+        return *this;
+    }
+
+    FrozenHashMap(const FrozenHashMap &) = delete;
+    FrozenHashMap &operator=(const FrozenHashMap &) = delete;
+
+    ~FrozenHashMap() {
+        for (BucketT *B = Entries, *E = Entries + NumEntries; B != E; ++B) {
+            B->GetSecond().~ValueT();
+            B->GetFirst().~KeyT();
+        }
+        ::operator delete(Entries);
+    }
+
+    void swap(FrozenHashMap &RHS) {
+        std::swap(Entries, RHS.Entries);
+        std::swap(Pilots, RHS.Pilots);
+        std::swap(NumEntries, RHS.NumEntries);
+        std::swap(NumPilots, RHS.NumPilots);
+        std::swap(Seed, RHS.Seed);
+    }
+
+    bool empty() const { return NumEntries == 0; }
+    unsigned size() const { return NumEntries; }
+
+    const_iterator begin() const { return Entries; }
+    const_iterator end() const { return Entries + NumEntries; }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    size_type count(const KeyT &Val) const {
+        return LookupBucketFor(Val) ? 1 : 0;
+    }
+
+    const_iterator find(const KeyT &Val) const {
+        const BucketT *B = LookupBucketFor(Val);
+        return B ? B : end();
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    ValueT lookup(const KeyT &Val) const {
+        const BucketT *B = LookupBucketFor(Val);
+        return B ? B->GetSecond() : ValueT();
+    }
+
+    /// Return the size in bytes of the entries and the pilots.
+    size_t getMemorySize() const {
+        return NumEntries * sizeof(BucketT) + NumPilots * sizeof(uint32_t);
+    }
+
+private:
+    uint64_t getKeyHash(const KeyT &Val) const {
+        return hashing::detail::hash_16_bytes(size_t(hash_value(Val)), Seed);
+    }
+
+    /// The group of a key, from the high half of its hash.
+    unsigned getPilotIndex(uint64_t Hash) const {
+        return static_cast<unsigned>(((Hash >> 32) * NumPilots) >> 32);
+    }
+
+    /// The slot a key lands on with pilot \p Pilot, ignoring DirectSlot. The
+    /// key hash is already well mixed, so one multiply is enough to spread
+    /// the keys of a group differently for every pilot.
+    unsigned getHashedSlot(uint64_t Hash, uint32_t Pilot) const {
+        const uint64_t Mixed =
+            (Hash ^ (Pilot * 0x9E3779B97F4A7C15ULL)) * 0xff51afd7ed558ccdULL;
+        return static_cast<unsigned>(((Mixed >> 32) * NumEntries) >> 32);
+    }
+
+    const BucketT *LookupBucketFor(const KeyT &Val) const {
+        if (NumEntries == 0) return nullptr;
+        const uint64_t Hash = getKeyHash(Val);
+        const uint32_t Pilot = Pilots[getPilotIndex(Hash)];
+        const unsigned Hashed = getHashedSlot(Hash, Pilot);
+        const BucketT *B =
+            Entries + ((Pilot & DirectSlot) ? Pilot & ~DirectSlot : Hashed);
+        return KeyInfoT::IsEqual(Val, B->GetFirst()) ? B : nullptr;
+    }
+
+    template <typename MapT>
+    void build(const MapT &Map) {
+        assert(Map.size() < DirectSlot && "Too many entries!");
+        NumEntries = Map.size();
+        if (NumEntries == 0) return;
+        NumPilots = (NumEntries + KeysPerPilot - 1) / KeysPerPilot;
+        Pilots.reset(new uint32_t[NumPilots]());
+
+        std::vector<const typename MapT::value_type *> Sources;
+        Sources.reserve(NumEntries);
+        for (const auto &B : Map) Sources.push_back(&B);
+
+        // Slots[i] is where Sources[i] goes.
+        std::vector<unsigned> Slots(NumEntries);
+        for (unsigned Attempt = 0;; ++Attempt) {
+            if (Attempt == MaxAttempts) {
+                Pilots.reset();
+                NumEntries = NumPilots = 0;
+                throw std::invalid_argument(
+                    "FrozenHashMap: distinct keys with equal hashes");
+            }
+            Seed = 0x9E3779B97F4A7C15ULL * (Attempt + 1);
+            if (placeKeys(Sources, Slots)) break;
+        }
+
+        Entries = static_cast<BucketT *>(
+            ::operator new(NumEntries * sizeof(BucketT)));
+        for (unsigned i = 0; i != NumEntries; ++i) {
+            BucketT &B = Entries[Slots[i]];
+            ::new (&B.GetFirst()) KeyT(Sources[i]->GetFirst());
+            ::new (&B.GetSecond()) ValueT(Sources[i]->GetSecond());
+        }
+    }
+
+    /// Find a pilot for every group with the current seed, filling in
+    /// Pilots and \p Slots. Returns false if some group found none.
+    template <typename SourceT>
+    bool placeKeys(const std::vector<SourceT> &Sources,
+                   std::vector<unsigned> &Slots) {
+        std::vector<uint64_t> Hashes(NumEntries);
+        std::vector<unsigned> GroupStart(NumPilots + 1);
+        for (unsigned i = 0; i != NumEntries; ++i) {
+            Hashes[i] = getKeyHash(Sources[i]->GetFirst());
+            ++GroupStart[getPilotIndex(Hashes[i]) + 1];
+        }
+
+        // Sort the keys by group, and the groups by decreasing size, both
+        // with a counting sort.
+        unsigned MaxGroupSize = 0;
+        for (unsigned g = 0; g != NumPilots; ++g)
+            MaxGroupSize = std::max(MaxGroupSize, GroupStart[g + 1]);
+        std::vector<unsigned> SizeStart(MaxGroupSize + 2);
+        for (unsigned g = 0; g != NumPilots; ++g)
+            ++SizeStart[MaxGroupSize - GroupStart[g + 1] + 1];
+        for (unsigned s = 1; s != SizeStart.size(); ++s)
+            SizeStart[s] += SizeStart[s - 1];
+        std::vector<unsigned> Groups(NumPilots);
+        for (unsigned g = 0; g != NumPilots; ++g)
+            Groups[SizeStart[MaxGroupSize - GroupStart[g + 1]]++] = g;
+
+        for (unsigned g = 0; g != NumPilots; ++g)
+            GroupStart[g + 1] += GroupStart[g];
+        std::vector<unsigned> Members(NumEntries);
+        {
+            std::vector<unsigned> Next(GroupStart.begin(),
+                                       GroupStart.end() - 1);
+            for (unsigned i = 0; i != NumEntries; ++i)
+                Members[Next[getPilotIndex(Hashes[i])]++] = i;
+        }
+
+        std::vector<bool> Taken(NumEntries);
+        std::vector<unsigned> Candidate(MaxGroupSize);
+        unsigned FreeSlot = 0;
+        for (unsigned g : Groups) {
+            const unsigned *First = &Members[GroupStart[g]];
+            const unsigned Size = GroupStart[g + 1] - GroupStart[g];
+            if (Size == 0) {
+                Pilots[g] = 0;
+                continue;
+            }
+            if (Size == 1) {
+                // Every group left is a single key, take the free slots in
+                // order.
+                while (Taken[FreeSlot]) ++FreeSlot;
+                Taken[FreeSlot] = true;
+                Slots[*First] = FreeSlot;
+                Pilots[g] = DirectSlot | FreeSlot;
+                continue;
+            }
+
+            uint32_t Pilot = 0;
+            for (;; ++Pilot) {
+                if (Pilot == MaxPilot) return false;
+                unsigned k = 0;
+                for (; k != Size; ++k) {
+                    const unsigned Slot =
+                        getHashedSlot(Hashes[First[k]], Pilot);
+                    if (Taken[Slot]) break;
+                    Taken[Slot] = true;  // Catches collisions within the group.
+                    Candidate[k] = Slot;
+                }
+                if (k == Size) break;
+                while (k != 0) Taken[Candidate[--k]] = false;
+            }
+            Pilots[g] = Pilot;
+            for (unsigned k = 0; k != Size; ++k) Slots[First[k]] = Candidate[k];
+        }
+        return true;
+    }
+};
@@ -148,6 +148,126 @@ inline uint64_t hash_short(const char *s, size_t length, uint64_t seed) {
     return k2 ^ seed;
 }
 
+#if __cplusplus >= 201402L
+/// Constant-expression versions of hash_short() and hash_integer_value() with
+/// an explicit seed, for tables built at compile time (see
+/// densemap/static_hashmap.h). They read bytes one at a time in little-endian
+/// order, which is what fetch32() and fetch64() produce, so they agree with
+/// the functions above for the same seed.
+namespace cx {
+
+constexpr uint64_t fetch64(const char *p) {
+    uint64_t result = 0;
+    for (int i = 7; i >= 0; --i)
+        result = (result << 8) | static_cast<uint8_t>(p[i]);
+    return result;
+}
+
+constexpr uint32_t fetch32(const char *p) {
+    uint32_t result = 0;
+    for (int i = 3; i >= 0; --i)
+        result = (result << 8) | static_cast<uint8_t>(p[i]);
+    return result;
+}
+
+constexpr uint64_t rotate(uint64_t val, size_t shift) {
+    return shift == 0 ? val : ((val >> shift) | (val << (64 - shift)));
+}
+
+constexpr uint64_t shift_mix(uint64_t val) { return val ^ (val >> 47); }
+
+constexpr uint64_t hash_16_bytes(uint64_t low, uint64_t high) {
+    const uint64_t kMul = 0x9ddfea08eb382d69ULL;
+    uint64_t a = (low ^ high) * kMul;
+    a ^= (a >> 47);
+    uint64_t b = (high ^ a) * kMul;
+    b ^= (b >> 47);
+    b *= kMul;
+    return b;
+}
+
+constexpr uint64_t hash_1to3_bytes(const char *s, size_t len, uint64_t seed) {
+    const uint8_t a = s[0];
+    const uint8_t b = s[len >> 1];
+    const uint8_t c = s[len - 1];
+    const uint32_t y =
+        static_cast<uint32_t>(a) + (static_cast<uint32_t>(b) << 8);
+    const uint32_t z = len + (static_cast<uint32_t>(c) << 2);
+    return shift_mix(y * k2 ^ z * k3 ^ seed) * k2;
+}
+
+constexpr uint64_t hash_4to8_bytes(const char *s, size_t len, uint64_t seed) {
+    const uint64_t a = fetch32(s);
+    return hash_16_bytes(len + (a << 3), seed ^ fetch32(s + len - 4));
+}
+
+constexpr uint64_t hash_9to16_bytes(const char *s, size_t len,
+                                    uint64_t seed) {
+    const uint64_t a = fetch64(s);
+    const uint64_t b = fetch64(s + len - 8);
+    return hash_16_bytes(seed ^ a, rotate(b + len, len)) ^ b;
+}
+
+constexpr uint64_t hash_17to32_bytes(const char *s, size_t len,
+                                     uint64_t seed) {
+    const uint64_t a = fetch64(s) * k1;
+    const uint64_t b = fetch64(s + 8);
+    const uint64_t c = fetch64(s + len - 8) * k2;
+    const uint64_t d = fetch64(s + len - 16) * k0;
+    return hash_16_bytes(rotate(a - b, 43) + rotate(c ^ seed, 30) + d,
+                         a + rotate(b ^ k3, 20) - c + len + seed);
+}
+
+constexpr uint64_t hash_33to64_bytes(const char *s, size_t len,
+                                     uint64_t seed) {
+    uint64_t z = fetch64(s + 24);
+    uint64_t a = fetch64(s) + (len + fetch64(s + len - 16)) * k0;
+    uint64_t b = rotate(a + z, 52);
+    uint64_t c = rotate(a, 37);
+    a += fetch64(s + 8);
+    c += rotate(a, 7);
+    a += fetch64(s + 16);
+    const uint64_t vf = a + z;
+    const uint64_t vs = b + rotate(a, 31) + c;
+    a = fetch64(s + 16) + fetch64(s + len - 32);
+    z = fetch64(s + len - 8);
+    b = rotate(a + z, 52);
+    c = rotate(a, 37);
+    a += fetch64(s + len - 24);
+    c += rotate(a, 7);
+    a += fetch64(s + len - 16);
+    const uint64_t wf = a + z;
+    const uint64_t ws = b + rotate(a, 31) + c;
+    const uint64_t r = shift_mix((vf + ws) * k2 + (wf + vs) * k0);
+    return shift_mix((seed ^ (r * k0)) + vs) * k2;
+}
+
+constexpr uint64_t hash_short(const char *s, size_t length, uint64_t seed) {
+    if (length >= 4 && length <= 8) return hash_4to8_bytes(s, length, seed);
+    if (length > 8 && length <= 16) return hash_9to16_bytes(s, length, seed);
+    if (length > 16 && length <= 32) return hash_17to32_bytes(s, length, seed);
+    if (length > 32) return hash_33to64_bytes(s, length, seed);
+    if (length != 0) return hash_1to3_bytes(s, length, seed);
+
+    return k2 ^ seed;
+}
+
+/// Hash a string of any length. Up to 64 bytes this is hash_short(); longer
+/// strings combine the hashes of their first and last 64 bytes.
+constexpr uint64_t hash_string(const char *s, size_t length, uint64_t seed) {
+    if (length <= 64) return hash_short(s, length, seed);
+    return hash_16_bytes(hash_short(s, 64, seed),
+                         hash_short(s + length - 64, 64, seed ^ length));
+}
+
+constexpr uint64_t hash_integer_value(uint64_t value, uint64_t seed) {
+    const uint64_t a = static_cast<uint32_t>(value);
+    return hash_16_bytes(seed + (a << 3), value >> 32);
+}
+
+}  // namespace cx
+#endif
+
 /// The intermediate state used during hashing.
 /// Currently, the algorithm for computing hash codes is based on CityHash and
 /// keeps 56 bytes of arbitrary state.
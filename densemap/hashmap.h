@@ -2,15 +2,28 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <new>
 #include <type_traits>
 #include <utility>
+#include <vector>
+#if __cplusplus >= 201703L
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define HASHMAP_HAVE_PMR 1
+#endif
+#endif
 
 #include "common/alignof.h"
 #include "common/math_utils.h"
+#include "common/parallel.h"
 #include "densemap/hashmap_info.h"
+#include "densemap/hashmap_probing.h"
+#include "densemap/hashmap_stats.h"
 
 namespace detail {
 
@@ -22,28 +35,193 @@ struct HashMapPair : public std::pair<KeyT, ValueT> {
     const ValueT &GetSecond() const { return std::pair<KeyT, ValueT>::second; }
 };
 
+/// HashMapHashedPair - A bucket that also caches the hash of its key. Use it
+/// as the BucketT parameter of HashMap or SmallHashMap when keys are
+/// expensive to hash or compare: Grow() scatters entries using the cached
+/// hash, and probes only call KeyInfoT::IsEqual when the hashes match. HashT
+/// may be widened to a 64-bit type. Buckets are created and erased with a
+/// hash of 0, so probing past them never reads an unset hash.
+template <typename KeyT, typename ValueT, typename HashT = uint32_t>
+struct HashMapHashedPair : public std::pair<KeyT, ValueT> {
+    HashT Hash;
+
+    KeyT &GetFirst() { return std::pair<KeyT, ValueT>::first; }
+    const KeyT &GetFirst() const { return std::pair<KeyT, ValueT>::first; }
+    ValueT &GetSecond() { return std::pair<KeyT, ValueT>::second; }
+    const ValueT &GetSecond() const { return std::pair<KeyT, ValueT>::second; }
+    HashT GetHash() const { return Hash; }
+    void SetHash(HashT H) { Hash = H; }
+};
+
+/// Inline bucket storage for SmallHashMap, followed by the metadata bytes the
+/// probing policy keeps for those buckets.
+template <typename BucketT, unsigned NumBuckets, size_t MetadataSize>
+struct InlineBucketStorage {
+    BucketT Buckets[NumBuckets];
+    uint8_t Metadata[MetadataSize];
+};
+
+template <typename BucketT, unsigned NumBuckets>
+struct InlineBucketStorage<BucketT, NumBuckets, 0> {
+    BucketT Buckets[NumBuckets];
+};
+
+/// Detects allocators with a reallocate(P, OldN, NewN) member that resizes a
+/// block without copying it, such as HugePageAllocator.
+template <typename AllocT, typename = void>
+struct HasReallocate : std::false_type {};
+
+template <typename AllocT>
+struct HasReallocate<
+    AllocT, decltype(void(std::declval<AllocT &>().reallocate(
+                std::declval<typename AllocT::value_type *>(), size_t(),
+                size_t())))> : std::true_type {};
+
+/// BucketAllocator - Obtains bucket arrays, together with the probing
+/// metadata that follows them, from a standard allocator. The allocator is
+/// rebound to BucketT and asked for whole buckets, so the array is aligned
+/// for BucketT whatever arena it comes from. Maps derive from this class so
+/// that a stateless allocator takes no space.
+template <typename BucketT, typename ProbeT, typename AllocatorT>
+class BucketAllocator
+    : private std::allocator_traits<AllocatorT>::template rebind_alloc<
+          BucketT> {
+    using AllocT = typename std::allocator_traits<
+        AllocatorT>::template rebind_alloc<BucketT>;
+    using Traits = std::allocator_traits<AllocT>;
+
+    /// Number of BucketT-sized units holding \p Num buckets and their
+    /// metadata.
+    static size_t getAllocationSize(size_t Num) {
+        return Num + (ProbeT::getMetadataSize(Num) + sizeof(BucketT) - 1) /
+                         sizeof(BucketT);
+    }
+
+public:
+    BucketAllocator() = default;
+    explicit BucketAllocator(const AllocatorT &Alloc) : AllocT(Alloc) {}
+
+    AllocatorT getAllocator() const {
+        return AllocatorT(static_cast<const AllocT &>(*this));
+    }
+
+    /// Allocate uninitialized storage for \p Num buckets and their probing
+    /// metadata.
+    BucketT *allocateBucketArray(size_t Num) {
+        return Traits::allocate(*this, getAllocationSize(Num));
+    }
+
+    void deallocateBucketArray(BucketT *Buckets, size_t Num) {
+        if (Buckets) Traits::deallocate(*this, Buckets, getAllocationSize(Num));
+    }
+
+    /// Resize \p Buckets to \p NewNum buckets without copying them, if the
+    /// allocator knows how. Returns the resized array, or null if the caller
+    /// has to allocate a new one; \p Buckets is left alone in that case.
+    BucketT *reallocateBucketArray(BucketT *Buckets, size_t OldNum,
+                                   size_t NewNum) {
+        return reallocateBucketArray(Buckets, OldNum, NewNum,
+                                     HasReallocate<AllocT>());
+    }
+
+    /// Exchange allocators if they propagate on swap. Otherwise each map
+    /// would free the other's buckets, so they must compare equal.
+    void swapAllocator(BucketAllocator &RHS) {
+        swapAllocator(RHS, typename Traits::propagate_on_container_swap());
+    }
+
+private:
+    BucketT *reallocateBucketArray(BucketT *Buckets, size_t OldNum,
+                                   size_t NewNum, std::true_type) {
+        return static_cast<AllocT &>(*this).reallocate(
+            Buckets, getAllocationSize(OldNum), getAllocationSize(NewNum));
+    }
+
+    BucketT *reallocateBucketArray(BucketT *, size_t, size_t,
+                                   std::false_type) {
+        return nullptr;
+    }
+
+    void swapAllocator(BucketAllocator &RHS, std::true_type) {
+        using std::swap;
+        swap(static_cast<AllocT &>(*this), static_cast<AllocT &>(RHS));
+    }
+
+    void swapAllocator(BucketAllocator &RHS, std::false_type) {
+        (void)RHS;  // silence warning.
+        assert(static_cast<AllocT &>(*this) == static_cast<AllocT &>(RHS) &&
+               "Swapping maps with unequal allocators!");
+    }
+};
+
+/// HashWidthTraits - The hash and size types of a map, chosen by the type
+/// KeyInfoT::GetHashValue returns. A 64-bit hash, as from WideHashMapInfo,
+/// selects the 64-bit mode: the whole hash is kept through probing, the
+/// home bucket comes from its high bits, and HashMap counts its buckets and
+/// entries in size_t, so a table can grow past 4G buckets. Otherwise hashes
+/// and counts are unsigned, as they have always been.
+template <typename KeyT, typename KeyInfoT>
+struct HashWidthTraits {
+    static constexpr bool Is64Bit =
+        sizeof(decltype(KeyInfoT::GetHashValue(
+            std::declval<const KeyT &>()))) == 8;
+    using HashT = typename std::conditional<Is64Bit, uint64_t, unsigned>::type;
+    using SizeT = typename std::conditional<Is64Bit, size_t, unsigned>::type;
+};
+
+/// KeepFirstValue, KeepLastValue - The combine functions build_parallel()
+/// uses for DuplicatePolicy::FirstWins and DuplicatePolicy::LastWins.
+struct KeepFirstValue {
+    template <typename ValueT, typename NewT>
+    void operator()(ValueT &, const NewT &) const {}
+};
+
+struct KeepLastValue {
+    template <typename ValueT, typename NewT>
+    void operator()(ValueT &Existing, const NewT &New) const {
+        Existing = New;
+    }
+};
+
 }  // end namespace detail
 
+/// DuplicatePolicy - Which value HashMapBase::build_parallel() keeps for a
+/// key that occurs more than once, in the input or already in the map.
+enum class DuplicatePolicy { FirstWins, LastWins };
+
 template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
           typename Bucket = detail::HashMapPair<KeyT, ValueT>,
-          bool IsConst = false>
+          bool IsConst = false, bool HasOccupancyBitmap = false>
 class HashMapIterator;
 
 template <typename DerivedT, typename KeyT, typename ValueT, typename KeyInfoT,
-          typename BucketT>
+          typename BucketT, typename ProbeT = QuadraticProbing>
 class HashMapBase {
     template <typename T>
     using const_arg_type_t = typename const_pointer_or_const_ref<T>::type;
 
+    // IncrementalHashMap drives the bucket arrays of its two tables directly.
+    template <typename, typename, typename, typename, typename>
+    friend class IncrementalHashMap;
+
+    using HashWidth = detail::HashWidthTraits<KeyT, KeyInfoT>;
+    using HashT = typename HashWidth::HashT;
+
+    static_assert(detail::BucketHashTraits<BucketT>::StoredHashSize == 0 ||
+                      detail::BucketHashTraits<BucketT>::StoredHashSize >=
+                          sizeof(HashT),
+                  "Buckets that cache the hash must hold all of it!");
+
 public:
-    using size_type = unsigned;
+    using size_type = typename HashWidth::SizeT;
     using key_type = KeyT;
     using mapped_type = ValueT;
     using value_type = BucketT;
 
-    using iterator = HashMapIterator<KeyT, ValueT, KeyInfoT, BucketT>;
-    using const_iterator =
-        HashMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>;
+    using iterator = HashMapIterator<KeyT, ValueT, KeyInfoT, BucketT, false,
+                                     ProbeT::HasOccupancyBitmap>;
+    using const_iterator = HashMapIterator<KeyT, ValueT, KeyInfoT, BucketT,
+                                           true, ProbeT::HasOccupancyBitmap>;
 
     inline iterator begin() {
         // When the map is empty, avoid the overhead of advancing/retreating
@@ -63,7 +241,7 @@ public:
     }
 
     bool empty() const { return num_entries() == 0; }
-    unsigned size() const { return num_entries(); }
+    size_type size() const { return num_entries(); }
 
     void reserve(size_type num_entries_) {
         auto num_buckets_ = getMinBucketToReserveForEntries(num_entries_);
@@ -81,12 +259,22 @@ public:
         }
 
         const KeyT EmptyKey = GetEmptyKey(), TombstoneKey = GetTombstoneKey();
-        if (std::is_pod<KeyT>::value && std::is_pod<ValueT>::value) {
+        if (ProbeT::HasOccupancyBitmap && num_to_mbstones() == 0) {
+            // Every bucket the bitmap leaves out is empty already.
+            forEachOccupiedBucket([&](BucketT &B) {
+                B.GetSecond().~ValueT();
+                B.GetFirst() = EmptyKey;
+                BucketHashTraits::SetHash(B, 0);
+            });
+        } else if (std::is_pod<KeyT>::value && std::is_pod<ValueT>::value) {
             // Use a simpler loop when these are trivial types.
-            for (BucketT *P = getBuckets(), *E = getBucketsend(); P != E; ++P)
+            for (BucketT *P = getBuckets(), *E = getBucketsend(); P != E;
+                 ++P) {
                 P->GetFirst() = EmptyKey;
+                BucketHashTraits::SetHash(*P, 0);
+            }
         } else {
-            unsigned num_entries_ = num_entries();
+            size_type num_entries_ = num_entries();
             for (BucketT *P = getBuckets(), *E = getBucketsend(); P != E; ++P) {
                 if (!KeyInfoT::IsEqual(P->GetFirst(), EmptyKey)) {
                     if (!KeyInfoT::IsEqual(P->GetFirst(), TombstoneKey)) {
@@ -94,14 +282,35 @@ public:
                         --num_entries_;
                     }
                     P->GetFirst() = EmptyKey;
+                    BucketHashTraits::SetHash(*P, 0);
                 }
             }
             assert(num_entries_ == 0 && "Node count imbalance!");
         }
+        ProbeT::initMetadata(getMetadata(), getNumBukets());
         set_num_entries(0);
         set_num_to_mbstones(0);
     }
 
+    /// compact - Rehash the table in place, turning every tombstone back into
+    /// an empty bucket. Unlike a same-size Grow() this allocates no second
+    /// bucket array. Invalidates iterators.
+    void compact() {
+        if (num_to_mbstones() != 0) rehashInPlace();
+    }
+
+    /// Insertions compact the table once tombstones occupy more than
+    /// \p Percent percent of its buckets. 0 disables this, leaving only the
+    /// compaction that happens when fewer than 1/8 of the buckets are empty.
+    void setMaxTombstonePercent(unsigned Percent) {
+        assert(Percent <= 100 && "Not a percentage!");
+        static_cast<DerivedT *>(this)->set_max_tombstone_percent(Percent);
+    }
+
+    unsigned getMaxTombstonePercent() const {
+        return static_cast<const DerivedT *>(this)->max_tombstone_percent();
+    }
+
     /// Return 1 if the specified key is in the map, 0 otherwise.
     size_type count(const_arg_type_t<KeyT> Val) const {
         const BucketT *the_bucket_;
@@ -111,13 +320,13 @@ public:
     iterator find(const_arg_type_t<KeyT> Val) {
         BucketT *the_bucket_;
         if (LookupBucketFor(Val, the_bucket_))
-            return MakeIterator(the_bucket_, getBucketsend(), *this, true);
+            return MakeIterator(the_bucket_, getBucketsend(), true);
         return end();
     }
     const_iterator find(const_arg_type_t<KeyT> Val) const {
         const BucketT *the_bucket_;
         if (LookupBucketFor(Val, the_bucket_))
-            return MakeConstIterator(the_bucket_, getBucketsend(), *this, true);
+            return MakeConstIterator(the_bucket_, getBucketsend(), true);
         return end();
     }
 
@@ -149,6 +358,39 @@ public:
         return ValueT();
     }
 
+    /// find_batch - Look up Keys[0, NumKeys) and store the iterator for
+    /// Keys[i], or end(), in Out[i]. The keys are hashed and their first
+    /// buckets prefetched a batch at a time before any probe runs, so the
+    /// cache misses of a large table overlap instead of being taken one
+    /// find() after the other.
+    void find_batch(const KeyT *Keys, size_t NumKeys, iterator *Out) {
+        LookupBatch(Keys, NumKeys, [&](size_t i, const BucketT *B) {
+            Out[i] = B ? MakeIterator(const_cast<BucketT *>(B),
+                                      getBucketsend(), true)
+                       : end();
+        });
+    }
+    void find_batch(const KeyT *Keys, size_t NumKeys,
+                    const_iterator *Out) const {
+        LookupBatch(Keys, NumKeys, [&](size_t i, const BucketT *B) {
+            Out[i] = B ? MakeConstIterator(B, getBucketsend(), true) : end();
+        });
+    }
+
+    /// count_batch - Store count(Keys[i]) in Out[i], as find_batch does.
+    void count_batch(const KeyT *Keys, size_t NumKeys, size_type *Out) const {
+        LookupBatch(Keys, NumKeys, [&](size_t i, const BucketT *B) {
+            Out[i] = B ? 1 : 0;
+        });
+    }
+
+    /// lookup_batch - Store lookup(Keys[i]) in Out[i], as find_batch does.
+    void lookup_batch(const KeyT *Keys, size_t NumKeys, ValueT *Out) const {
+        LookupBatch(Keys, NumKeys, [&](size_t i, const BucketT *B) {
+            Out[i] = B ? B->GetSecond() : ValueT();
+        });
+    }
+
     // Inserts key,value pair into the map if the key isn't already in the map.
     // If the key is already in the map, it returns false and doesn't update the
     // value.
@@ -169,13 +411,14 @@ public:
     template <typename... Ts>
     std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
         BucketT *the_bucket_;
-        if (LookupBucketFor(Key, the_bucket_))
+        const HashT Hash = GetHashValue(Key);
+        if (LookupBucketFor(Key, Hash, the_bucket_))
             return std::make_pair(
                 MakeIterator(the_bucket_, getBucketsend(), true),
                 false);  // Already in map.
 
         // Otherwise, insert the new element.
-        the_bucket_ = InsertIntoBucket(the_bucket_, std::move(Key),
+        the_bucket_ = InsertIntoBucket(the_bucket_, Hash, std::move(Key),
                                        std::forward<Ts>(Args)...);
         return std::make_pair(MakeIterator(the_bucket_, getBucketsend(), true),
                               true);
@@ -187,14 +430,15 @@ public:
     template <typename... Ts>
     std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
         BucketT *the_bucket_;
-        if (LookupBucketFor(Key, the_bucket_))
+        const HashT Hash = GetHashValue(Key);
+        if (LookupBucketFor(Key, Hash, the_bucket_))
             return std::make_pair(
                 MakeIterator(the_bucket_, getBucketsend(), true),
                 false);  // Already in map.
 
         // Otherwise, insert the new element.
-        the_bucket_ =
-            InsertIntoBucket(the_bucket_, Key, std::forward<Ts>(Args)...);
+        the_bucket_ = InsertIntoBucket(the_bucket_, Hash, Key,
+                                       std::forward<Ts>(Args)...);
         return std::make_pair(MakeIterator(the_bucket_, getBucketsend(), true),
                               true);
     }
@@ -203,14 +447,37 @@ public:
     std::pair<iterator, bool> insert_as(std::pair<KeyT, ValueT> &&KV,
                                         const LookupKeyT &Val) {
         BucketT *the_bucket_;
-        if (LookupBucketFor(Val, the_bucket_))
+        const HashT Hash = GetHashValue(Val);
+        if (LookupBucketFor(Val, Hash, the_bucket_))
             return std::make_pair(
                 MakeIterator(the_bucket_, getBucketsend(), true),
                 false);  // Already in map.
 
         // Otherwise, insert the new element.
         the_bucket_ = InsertIntoBucketWithLookup(
-            the_bucket_, std::move(KV.first), std::move(KV.second), Val);
+            the_bucket_, Hash, std::move(KV.first), std::move(KV.second), Val);
+        return std::make_pair(MakeIterator(the_bucket_, getBucketsend(), true),
+                              true);
+    }
+
+    /// try_emplace_as - try_emplace() with a different key type, as for
+    /// find_as(). The key is only built, as KeyT(Val), once it is known not
+    /// to be in the map.
+    template <typename LookupKeyT, typename... Ts>
+    std::pair<iterator, bool> try_emplace_as(const LookupKeyT &Val,
+                                             Ts &&... Args) {
+        BucketT *the_bucket_;
+        const HashT Hash = GetHashValue(Val);
+        if (LookupBucketFor(Val, Hash, the_bucket_))
+            return std::make_pair(
+                MakeIterator(the_bucket_, getBucketsend(), true),
+                false);  // Already in map.
+
+        // Otherwise, insert the new element.
+        KeyT Key(Val);
+        the_bucket_ = InsertIntoBucketImpl(Key, Val, Hash, the_bucket_);
+        the_bucket_->GetFirst() = std::move(Key);
+        ::new (&the_bucket_->GetSecond()) ValueT(std::forward<Ts>(Args)...);
         return std::make_pair(MakeIterator(the_bucket_, getBucketsend(), true),
                               true);
     }
@@ -221,38 +488,89 @@ public:
         for (; I != E; ++I) insert(*I);
     }
 
+    /// build_parallel - Insert the key/value pairs in [I, E) on up to
+    /// \p NumThreads threads. The table is sized for all of them and
+    /// cleared of tombstones up front, and the pairs are partitioned by the
+    /// top bits of their home bucket, so each partition is inserted into its
+    /// own region of the bucket array without any locking. A pair whose
+    /// probe sequence runs out of its region is inserted afterwards on the
+    /// calling thread. With one thread, or a table too small to split, this
+    /// is a plain insertion loop.
+    ///
+    /// \p Policy decides which value a key that occurs more than once keeps;
+    /// the order is that of [I, E), after the entries already in the map.
+    template <typename RandomIt>
+    void build_parallel(RandomIt I, RandomIt E, unsigned NumThreads,
+                        DuplicatePolicy Policy = DuplicatePolicy::FirstWins) {
+        if (Policy == DuplicatePolicy::FirstWins)
+            build_parallel(I, E, NumThreads, detail::KeepFirstValue());
+        else
+            build_parallel(I, E, NumThreads, detail::KeepLastValue());
+    }
+
+    /// Same as above, calling Combine(Existing, New) with the value in the
+    /// map and the one of the pair for every key that is already there.
+    /// Combine runs concurrently for different keys.
+    template <typename RandomIt, typename CombineT>
+    void build_parallel(RandomIt I, RandomIt E, unsigned NumThreads,
+                        CombineT Combine) {
+        if (I == E) return;
+        const size_t NumInputs = E - I;
+        assert(NumInputs <= std::numeric_limits<size_type>::max() -
+                                num_entries() &&
+               "Too many entries!");
+        reserve(num_entries() + NumInputs);
+
+        const unsigned NumParts = getNumBuildPartitions(NumThreads);
+        if (NumParts <= 1) {
+            for (; I != E; ++I) buildInsert(I->first, I->second, Combine);
+            return;
+        }
+
+        // The regions are filled without asking shouldGrow(), so the load
+        // factor reserve() left must be all that bounds them: tombstones
+        // could leave the deferred pairs without a single empty bucket.
+        compact();
+
+        std::vector<size_type> Deferred = insertPartitioned(
+            NumThreads, NumParts, NumInputs, /*MayExist=*/true,
+            [](size_t) { return false; },
+            [&](size_t i) { return GetHashValue(I[i].first); },
+            [&](size_t i) -> const KeyT & { return I[i].first; },
+            [&](size_t i, BucketT &B) {
+                B.GetFirst() = I[i].first;
+                ::new (&B.GetSecond()) ValueT(I[i].second);
+            },
+            [&](size_t i, BucketT &B) { Combine(B.GetSecond(), I[i].second); });
+        for (size_type i : Deferred)
+            buildInsert(I[i].first, I[i].second, Combine);
+    }
+
     bool erase(const KeyT &Val) {
         BucketT *the_bucket_;
         if (!LookupBucketFor(Val, the_bucket_)) return false;  // not in map.
 
-        the_bucket_->GetSecond().~ValueT();
-        the_bucket_->GetFirst() = GetTombstoneKey();
-        decrement_num_entries();
-        incrementnum_to_mbstones_();
+        eraseBucket(the_bucket_, MovesEntries());
         return true;
     }
-    void erase(iterator I) {
-        BucketT *the_bucket_ = &*I;
-        the_bucket_->GetSecond().~ValueT();
-        the_bucket_->GetFirst() = GetTombstoneKey();
-        decrement_num_entries();
-        incrementnum_to_mbstones_();
-    }
+    void erase(iterator I) { eraseBucket(&*I, MovesEntries()); }
 
     value_type &FindAndConstruct(const KeyT &Key) {
         BucketT *the_bucket_;
-        if (LookupBucketFor(Key, the_bucket_)) return *the_bucket_;
+        const HashT Hash = GetHashValue(Key);
+        if (LookupBucketFor(Key, Hash, the_bucket_)) return *the_bucket_;
 
-        return *InsertIntoBucket(the_bucket_, Key);
+        return *InsertIntoBucket(the_bucket_, Hash, Key);
     }
 
     ValueT &operator[](const KeyT &Key) { return FindAndConstruct(Key).second; }
 
     value_type &FindAndConstruct(KeyT &&Key) {
         BucketT *the_bucket_;
-        if (LookupBucketFor(Key, the_bucket_)) return *the_bucket_;
+        const HashT Hash = GetHashValue(Key);
+        if (LookupBucketFor(Key, Hash, the_bucket_)) return *the_bucket_;
 
-        return *InsertIntoBucket(the_bucket_, std::move(Key));
+        return *InsertIntoBucket(the_bucket_, Hash, std::move(Key));
     }
 
     ValueT &operator[](KeyT &&Key) {
@@ -268,13 +586,45 @@ public:
     /// determine whether an insertion caused the HashMap to reAllocate.
     const void *getPointerIntoBucketsArray() const { return getBuckets(); }
 
+    /// getStats - Return the occupancy of the table and, if built with
+    /// HASHMAP_ENABLE_STATS, the probe lengths of its lookups and the number
+    /// and duration of its grows and rehashes since it was created or
+    /// resetStats() was called.
+    HashMapStats getStats() const {
+        HashMapStats S;
+#if HASHMAP_ENABLE_STATS
+        Stats.copyTo(S);
+#endif
+        S.NumBuckets = getNumBukets();
+        S.NumEntries = num_entries();
+        S.NumTombstones = num_to_mbstones();
+        return S;
+    }
+
+    void resetStats() {
+#if HASHMAP_ENABLE_STATS
+        Stats.reset();
+#endif
+    }
+
 protected:
     HashMapBase() = default;
 
+    static constexpr unsigned DefaultMaxTombstonePercent = 25;
+
     void DestroyAll() {
         if (getNumBukets() == 0)  // Nothing to do.
             return;
 
+        if (ProbeT::HasOccupancyBitmap) {
+            forEachOccupiedBucket([](BucketT &B) { B.GetSecond().~ValueT(); });
+            if (!std::is_trivially_destructible<KeyT>::value)
+                for (BucketT *P = getBuckets(), *E = getBucketsend(); P != E;
+                     ++P)
+                    P->GetFirst().~KeyT();
+            return;
+        }
+
         const KeyT EmptyKey = GetEmptyKey(), TombstoneKey = GetTombstoneKey();
         for (BucketT *P = getBuckets(), *E = getBucketsend(); P != E; ++P) {
             if (!KeyInfoT::IsEqual(P->GetFirst(), EmptyKey) &&
@@ -284,6 +634,16 @@ protected:
         }
     }
 
+    /// forEachOccupiedBucket - Call Fn on every bucket holding an entry, as
+    /// told by the occupancy bitmap of an OccupancyBitmap policy.
+    template <typename FnT>
+    void forEachOccupiedBucket(FnT Fn) {
+        BucketT *Buckets = getBuckets();
+        detail::OccupancyBits::forEach(
+            getMetadata(), getNumBukets(),
+            [&](size_t BucketNo) { Fn(Buckets[BucketNo]); });
+    }
+
     void initEmpty() {
         set_num_entries(0);
         set_num_to_mbstones(0);
@@ -291,13 +651,16 @@ protected:
         assert((getNumBukets() & (getNumBukets() - 1)) == 0 &&
                "# initial buckets must be a power of two!");
         const KeyT EmptyKey = GetEmptyKey();
-        for (BucketT *B = getBuckets(), *E = getBucketsend(); B != E; ++B)
+        for (BucketT *B = getBuckets(), *E = getBucketsend(); B != E; ++B) {
             ::new (&B->GetFirst()) KeyT(EmptyKey);
+            BucketHashTraits::SetHash(*B, 0);
+        }
+        ProbeT::initMetadata(getMetadata(), getNumBukets());
     }
 
     /// Returns the number of buckets to Allocate to ensure that the HashMap can
     /// accommodate \p num_entries_ without need to Grow().
-    unsigned getMinBucketToReserveForEntries(unsigned num_entries_) {
+    size_type getMinBucketToReserveForEntries(size_type num_entries_) {
         // Ensure that "num_entries_ * 4 < num_buckets_ * 3"
         if (num_entries_ == 0) return 0;
         // +1 is required because of the strict equality.
@@ -313,27 +676,105 @@ protected:
         const KeyT TombstoneKey = GetTombstoneKey();
         for (BucketT *B = OldBucketsBegin, *E = OldBucketsend; B != E; ++B) {
             if (!KeyInfoT::IsEqual(B->GetFirst(), EmptyKey) &&
-                !KeyInfoT::IsEqual(B->GetFirst(), TombstoneKey)) {
-                // Insert the key/value into the new table.
-                BucketT *DestBucket;
-                bool FoundVal = LookupBucketFor(B->GetFirst(), DestBucket);
-                (void)FoundVal;  // silence warning.
-                assert(!FoundVal && "Key already in new map?");
-                DestBucket->GetFirst() = std::move(B->GetFirst());
-                ::new (&DestBucket->GetSecond())
-                    ValueT(std::move(B->GetSecond()));
-                incrementnum_entries_();
-
-                // Free the value.
-                B->GetSecond().~ValueT();
-            }
+                !KeyInfoT::IsEqual(B->GetFirst(), TombstoneKey))
+                moveFromOldBucket(*B);
             B->GetFirst().~KeyT();
         }
     }
 
+    /// Same as above on up to \p NumThreads threads, once the old table has
+    /// MinParallelGrowBuckets buckets: the entries are partitioned by the
+    /// region of the new table they belong to and inserted into the regions
+    /// concurrently, as build_parallel() does.
+    void moveFromOldBuckets(BucketT *OldBucketsBegin, BucketT *OldBucketsend,
+                            unsigned NumThreads) {
+        const size_t NumOld = OldBucketsend - OldBucketsBegin;
+        const unsigned NumParts = getNumBuildPartitions(NumThreads);
+        if (NumOld < MinParallelGrowBuckets || NumParts <= 1) {
+            moveFromOldBuckets(OldBucketsBegin, OldBucketsend);
+            return;
+        }
+
+        set_num_entries(0);
+        set_num_to_mbstones(0);
+        const KeyT EmptyKey = GetEmptyKey();
+        const KeyT TombstoneKey = GetTombstoneKey();
+        BucketT *NewBuckets = getBuckets();
+        const size_t NumNew = getNumBukets();
+        parallelFor(NumThreads, NumParts, [&](size_t P) {
+            for (size_t i = P * NumNew / NumParts,
+                        E = (P + 1) * NumNew / NumParts;
+                 i != E; ++i) {
+                ::new (&NewBuckets[i].GetFirst()) KeyT(EmptyKey);
+                BucketHashTraits::SetHash(NewBuckets[i], 0);
+            }
+        });
+        ProbeT::initMetadata(getMetadata(), getNumBukets());
+
+        BucketT *Old = OldBucketsBegin;
+        std::vector<size_type> Deferred = insertPartitioned(
+            NumThreads, NumParts, NumOld, /*MayExist=*/false,
+            [&](size_t i) {
+                return KeyInfoT::IsEqual(Old[i].GetFirst(), EmptyKey) ||
+                       KeyInfoT::IsEqual(Old[i].GetFirst(), TombstoneKey);
+            },
+            [&](size_t i) {
+                return BucketHashTraits::template GetHash<KeyInfoT>(Old[i]);
+            },
+            [&](size_t i) -> const KeyT & { return Old[i].GetFirst(); },
+            [&](size_t i, BucketT &B) {
+                B.GetFirst() = std::move(Old[i].GetFirst());
+                ::new (&B.GetSecond()) ValueT(std::move(Old[i].GetSecond()));
+                Old[i].GetSecond().~ValueT();
+            },
+            [](size_t, BucketT &) {});
+        for (size_type i : Deferred) moveFromOldBucket(Old[i]);
+
+        parallelFor(NumThreads, NumParts, [&](size_t P) {
+            for (size_t i = P * NumOld / NumParts,
+                        E = (P + 1) * NumOld / NumParts;
+                 i != E; ++i)
+                Old[i].GetFirst().~KeyT();
+        });
+    }
+
+    /// moveFromOldBucket - Move the entry in \p B, a bucket of the old
+    /// table, into the new one and destroy its value.
+    void moveFromOldBucket(BucketT &B) {
+        // The new table has no tombstones and can't hold the key yet, so
+        // the first empty bucket on the probe sequence is the right one, or
+        // for a policy that moves entries, the one it picks.
+        const HashT Hash = BucketHashTraits::template GetHash<KeyInfoT>(B);
+        BucketT *DestBucket = ProbeT::template FindEmptyBucket<KeyInfoT>(
+            getBuckets(), getMetadata(), getNumBukets(), Hash);
+        makeRoomAt(DestBucket, MovesEntries());
+        ProbeT::setFull(getMetadata(), getNumBukets(),
+                        DestBucket - getBuckets(), Hash);
+        BucketHashTraits::SetHash(*DestBucket, Hash);
+        DestBucket->GetFirst() = std::move(B.GetFirst());
+        ::new (&DestBucket->GetSecond()) ValueT(std::move(B.GetSecond()));
+        incrementnum_entries_();
+
+        // Free the value.
+        B.GetSecond().~ValueT();
+    }
+
+    /// moveWithinBuckets - Rehash after the bucket array was grown in place:
+    /// the first \p OldNumBuckets buckets still hold the old table, the
+    /// rest are uninitialized.
+    void moveWithinBuckets(size_type OldNumBuckets) {
+        const KeyT EmptyKey = GetEmptyKey();
+        for (BucketT *B = getBuckets() + OldNumBuckets, *E = getBucketsend();
+             B != E; ++B) {
+            ::new (&B->GetFirst()) KeyT(EmptyKey);
+            BucketHashTraits::SetHash(*B, 0);
+        }
+        rehashInPlace();
+    }
+
     template <typename OtherBaseT>
-    void CopyFrom(
-        const HashMapBase<OtherBaseT, KeyT, ValueT, KeyInfoT, BucketT> &other) {
+    void CopyFrom(const HashMapBase<OtherBaseT, KeyT, ValueT, KeyInfoT, BucketT,
+                                    ProbeT> &other) {
         assert(&other != this);
         assert(getNumBukets() == other.getNumBukets());
 
@@ -347,6 +788,8 @@ protected:
             for (size_t i = 0; i < getNumBukets(); ++i) {
                 ::new (&getBuckets()[i].GetFirst())
                     KeyT(other.getBuckets()[i].GetFirst());
+                BucketHashTraits::CopyHash(getBuckets()[i],
+                                           other.getBuckets()[i]);
                 if (!KeyInfoT::IsEqual(getBuckets()[i].GetFirst(),
                                        GetEmptyKey()) &&
                     !KeyInfoT::IsEqual(getBuckets()[i].GetFirst(),
@@ -354,14 +797,17 @@ protected:
                     ::new (&getBuckets()[i].GetSecond())
                         ValueT(other.getBuckets()[i].GetSecond());
             }
+        if (ProbeT::UsesMetadata)
+            std::memcpy(getMetadata(), other.getMetadata(),
+                        ProbeT::getMetadataSize(getNumBukets()));
     }
 
-    static unsigned GetHashValue(const KeyT &Val) {
+    static HashT GetHashValue(const KeyT &Val) {
         return KeyInfoT::GetHashValue(Val);
     }
 
     template <typename LookupKeyT>
-    static unsigned GetHashValue(const LookupKeyT &Val) {
+    static HashT GetHashValue(const LookupKeyT &Val) {
         return KeyInfoT::GetHashValue(Val);
     }
 
@@ -373,7 +819,212 @@ protected:
 
     static const KeyT GetTombstoneKey() { return KeyInfoT::GetTombstoneKey(); }
 
+    using BucketHashTraits = detail::BucketHashTraits<BucketT>;
+    using MovesEntries = std::integral_constant<bool, ProbeT::MovesEntries>;
+
+    /// The probing policy's metadata lives right after the bucket array.
+    uint8_t *getMetadata() {
+        return reinterpret_cast<uint8_t *>(getBucketsend());
+    }
+
+    const uint8_t *getMetadata() const {
+        return reinterpret_cast<const uint8_t *>(getBucketsend());
+    }
+
 private:
+#if HASHMAP_ENABLE_STATS
+    // Lookups through a const map count too.
+    mutable detail::HashMapStatsCounters Stats;
+    using StatsTimer = detail::HashMapStatsCounters::Timer;
+    using StatsEvent = detail::HashMapStatsCounters::Event;
+
+    /// recordProbes - Count the probes a lookup of \p Val takes.
+    template <typename LookupKeyT>
+    void recordProbes(const LookupKeyT &Val, HashT Hash) const {
+        const BucketT *Buckets = getBuckets();
+        const KeyT EmptyKey = GetEmptyKey();
+        uint64_t Visited = 0;
+        ProbeT::FindBucketIf(getNumBukets(), Hash, [&](size_t i) {
+            ++Visited;
+            const KeyT &Key = Buckets[i].GetFirst();
+            return KeyInfoT::IsEqual(Val, Key) ||
+                   KeyInfoT::IsEqual(Key, EmptyKey);
+        });
+        Stats.recordLookup((Visited + ProbeT::BucketsPerProbe - 1) /
+                           ProbeT::BucketsPerProbe);
+    }
+#endif
+
+    /// Number of keys the *_batch methods hash and prefetch ahead of the key
+    /// being probed.
+    static constexpr unsigned LookupBatchAhead = 16;
+
+    /// build_parallel() gives every partition a region of at least this
+    /// many buckets, so few probe sequences run out of theirs.
+    static constexpr unsigned MinBuildRegionSize = 4096;
+
+    /// A multi-threaded Grow() rehashes smaller tables serially, as the
+    /// threads would cost more than they save.
+    static constexpr unsigned MinParallelGrowBuckets = 1U << 18;
+
+    /// getNumBuildPartitions - The number of regions build_parallel() splits
+    /// the bucket array into: a power of two, a few per thread to balance
+    /// the load. 1 means inserting serially, which is also the only option
+    /// when insertions move entries that other threads may be probing.
+    unsigned getNumBuildPartitions(unsigned NumThreads) const {
+        if (ProbeT::MovesEntries || NumThreads <= 1) return 1;
+        unsigned NumParts = NextPowerOf2(std::min(NumThreads, 1024U) * 4 - 1);
+        while (NumParts > 1 && getNumBukets() / NumParts < MinBuildRegionSize)
+            NumParts /= 2;
+        return NumParts;
+    }
+
+    /// insertPartitioned - The parallel part of build_parallel() and of a
+    /// multi-threaded Grow(). Item i of [0, NumItems), unless Skip(i), has
+    /// the hash HashOf(i) and is inserted by the thread that owns the region
+    /// of the bucket array its home bucket is in: Place(i, B) fills the
+    /// empty bucket B with it. If \p MayExist, Merge(i, B) is called instead
+    /// when B already holds KeyOf(i). Returns the items whose probe sequence
+    /// ran out of their region, by region and in item order within one, for
+    /// the caller to insert serially.
+    template <typename SkipFnT, typename HashFnT, typename KeyFnT,
+              typename PlaceFnT, typename MergeFnT>
+    std::vector<size_type> insertPartitioned(unsigned NumThreads,
+                                             unsigned NumParts, size_t NumItems,
+                                             bool MayExist, SkipFnT Skip,
+                                             HashFnT HashOf, KeyFnT KeyOf,
+                                             PlaceFnT Place, MergeFnT Merge) {
+        // Region P of the bucket array holds the buckets whose index has P
+        // in its top bits.
+        const size_type N = getNumBukets();
+        const unsigned Shift =
+            countTrailingZeros(N) - countTrailingZeros(NumParts);
+        auto PartitionOf = [=](HashT Hash) {
+            return ProbeT::FindBucketIf(N, Hash, [](size_t) {
+                       return true;
+                   }) >> Shift;
+        };
+
+        // Hash the items and count those of each partition per chunk, then
+        // lay the partitions out one after the other, keeping the item
+        // order within each of them.
+        const size_t NumChunks = std::min<size_t>(NumThreads, NumItems);
+        const size_t ChunkSize = (NumItems + NumChunks - 1) / NumChunks;
+        std::vector<HashT> Hashes(NumItems);
+        std::vector<size_t> Offsets(NumChunks * NumParts);
+        parallelFor(NumThreads, NumChunks, [&](size_t Chunk) {
+            size_t *Counts = &Offsets[Chunk * NumParts];
+            const size_t End = std::min(NumItems, (Chunk + 1) * ChunkSize);
+            for (size_t i = Chunk * ChunkSize; i < End; ++i) {
+                if (Skip(i)) continue;
+                Hashes[i] = HashOf(i);
+                ++Counts[PartitionOf(Hashes[i])];
+            }
+        });
+        std::vector<size_t> PartBegin(NumParts + 1);
+        size_t Sum = 0;
+        for (unsigned P = 0; P != NumParts; ++P) {
+            PartBegin[P] = Sum;
+            for (size_t Chunk = 0; Chunk != NumChunks; ++Chunk) {
+                const size_t Count = Offsets[Chunk * NumParts + P];
+                Offsets[Chunk * NumParts + P] = Sum;
+                Sum += Count;
+            }
+        }
+        PartBegin[NumParts] = Sum;
+        std::vector<size_type> Order(Sum);
+        parallelFor(NumThreads, NumChunks, [&](size_t Chunk) {
+            size_t *Next = &Offsets[Chunk * NumParts];
+            const size_t End = std::min(NumItems, (Chunk + 1) * ChunkSize);
+            for (size_t i = Chunk * ChunkSize; i < End; ++i)
+                if (!Skip(i))
+                    Order[Next[PartitionOf(Hashes[i])]++] =
+                        static_cast<size_type>(i);
+        });
+
+        // Insert each partition into its region. A probe that reaches a
+        // bucket outside the region stops there and defers the item, so no
+        // two threads ever touch the same bucket or metadata byte.
+        std::vector<std::vector<size_type>> Deferred(NumParts);
+        std::vector<size_type> Added(NumParts);
+        BucketT *Buckets = getBuckets();
+        uint8_t *Meta = getMetadata();
+        const KeyT EmptyKey = GetEmptyKey();
+        parallelFor(NumThreads, NumParts, [&](size_t P) {
+            for (size_t k = PartBegin[P]; k != PartBegin[P + 1]; ++k) {
+                const size_type i = Order[k];
+                const HashT ItemHash = Hashes[i];
+                bool Left = false, Found = false;
+                const size_t BucketNo =
+                    ProbeT::FindBucketIf(N, ItemHash, [&](size_t j) {
+                        if ((j >> Shift) != P) return Left = true;
+                        const BucketT &B = Buckets[j];
+                        if (KeyInfoT::IsEqual(B.GetFirst(), EmptyKey))
+                            return true;
+                        return Found =
+                                   MayExist &&
+                                   BucketHashTraits::MayMatch(B, ItemHash) &&
+                                   KeyInfoT::IsEqual(KeyOf(i), B.GetFirst());
+                    });
+                BucketT &B = Buckets[BucketNo];
+                if (Left) {
+                    Deferred[P].push_back(i);
+                } else if (Found) {
+                    Merge(i, B);
+                } else {
+                    Place(i, B);
+                    BucketHashTraits::SetHash(B, ItemHash);
+                    ProbeT::setFull(Meta, N, BucketNo, ItemHash);
+                    ++Added[P];
+                }
+            }
+        });
+
+        size_type NumAdded = 0;
+        for (size_type Count : Added) NumAdded += Count;
+        set_num_entries(num_entries() + NumAdded);
+        for (size_t P = 1; P != NumParts; ++P)
+            Deferred[0].insert(Deferred[0].end(), Deferred[P].begin(),
+                               Deferred[P].end());
+        return std::move(Deferred[0]);
+    }
+
+    /// buildInsert - Insert one pair of build_parallel() serially.
+    template <typename NewT, typename CombineT>
+    void buildInsert(const KeyT &Key, const NewT &Value, CombineT &Combine) {
+        std::pair<iterator, bool> Res = try_emplace(Key, Value);
+        if (!Res.second) Combine(Res.first->GetSecond(), Value);
+    }
+
+    /// LookupBatch - Call Fn(i, B) for every key, where B is the bucket
+    /// holding Keys[i] or null. Key i + LookupBatchAhead is hashed and
+    /// prefetched right before key i is probed, so the window of
+    /// outstanding loads stays full across the whole batch.
+    template <typename FnT>
+    void LookupBatch(const KeyT *Keys, size_t NumKeys, FnT Fn) const {
+        if (getNumBukets() == 0) {
+            for (size_t i = 0; i != NumKeys; ++i) Fn(i, nullptr);
+            return;
+        }
+
+        const unsigned Mask = LookupBatchAhead - 1;
+        HashT Hashes[LookupBatchAhead];
+        auto Prepare = [&](size_t i) {
+            Hashes[i & Mask] = GetHashValue(Keys[i]);
+            ProbeT::Prefetch(getBuckets(), getMetadata(), getNumBukets(),
+                             Hashes[i & Mask]);
+        };
+        for (size_t i = 0; i != std::min<size_t>(NumKeys, LookupBatchAhead);
+             ++i)
+            Prepare(i);
+        for (size_t i = 0; i != NumKeys; ++i) {
+            const HashT Hash = Hashes[i & Mask];
+            if (i + LookupBatchAhead < NumKeys) Prepare(i + LookupBatchAhead);
+            const BucketT *B;
+            Fn(i, LookupBucketFor(Keys[i], Hash, B) ? B : nullptr);
+        }
+    }
+
     iterator MakeIterator(BucketT *P, BucketT *E, bool NoAdvance = false) {
         return iterator(P, E, NoAdvance);
     }
@@ -387,11 +1038,11 @@ private:
         return const_iterator(P, E, NoAdvance);
     }
 
-    unsigned num_entries() const {
+    size_type num_entries() const {
         return static_cast<const DerivedT *>(this)->num_entries();
     }
 
-    void set_num_entries(unsigned Num) {
+    void set_num_entries(size_type Num) {
         static_cast<DerivedT *>(this)->set_num_entries(Num);
     }
 
@@ -399,11 +1050,11 @@ private:
 
     void decrement_num_entries() { set_num_entries(num_entries() - 1); }
 
-    unsigned num_to_mbstones() const {
+    size_type num_to_mbstones() const {
         return static_cast<const DerivedT *>(this)->num_to_mbstones();
     }
 
-    void set_num_to_mbstones(unsigned Num) {
+    void set_num_to_mbstones(size_type Num) {
         static_cast<DerivedT *>(this)->set_num_to_mbstones(Num);
     }
 
@@ -423,7 +1074,7 @@ private:
         return static_cast<DerivedT *>(this)->getBuckets();
     }
 
-    unsigned getNumBukets() const {
+    size_type getNumBukets() const {
         return static_cast<const DerivedT *>(this)->getNumBukets();
     }
 
@@ -433,7 +1084,10 @@ private:
         return getBuckets() + getNumBukets();
     }
 
-    void Grow(unsigned AtLeast) {
+    void Grow(size_type AtLeast) {
+#if HASHMAP_ENABLE_STATS
+        StatsTimer Timer(Stats, StatsEvent::Grow);
+#endif
         static_cast<DerivedT *>(this)->Grow(AtLeast);
     }
 
@@ -442,9 +1096,9 @@ private:
     }
 
     template <typename KeyArg, typename... ValueArgs>
-    BucketT *InsertIntoBucket(BucketT *the_bucket_, KeyArg &&Key,
+    BucketT *InsertIntoBucket(BucketT *the_bucket_, HashT Hash, KeyArg &&Key,
                               ValueArgs &&... Values) {
-        the_bucket_ = InsertIntoBucketImpl(Key, Key, the_bucket_);
+        the_bucket_ = InsertIntoBucketImpl(Key, Key, Hash, the_bucket_);
 
         the_bucket_->GetFirst() = std::forward<KeyArg>(Key);
         ::new (&the_bucket_->GetSecond())
@@ -453,9 +1107,10 @@ private:
     }
 
     template <typename LookupKeyT>
-    BucketT *InsertIntoBucketWithLookup(BucketT *the_bucket_, KeyT &&Key,
-                                        ValueT &&Value, LookupKeyT &Lookup) {
-        the_bucket_ = InsertIntoBucketImpl(Key, Lookup, the_bucket_);
+    BucketT *InsertIntoBucketWithLookup(BucketT *the_bucket_, HashT Hash,
+                                        KeyT &&Key, ValueT &&Value,
+                                        LookupKeyT &Lookup) {
+        the_bucket_ = InsertIntoBucketImpl(Key, Lookup, Hash, the_bucket_);
 
         the_bucket_->GetFirst() = std::move(Key);
         ::new (&the_bucket_->GetSecond()) ValueT(std::move(Value));
@@ -464,19 +1119,21 @@ private:
 
     template <typename LookupKeyT>
     BucketT *InsertIntoBucketImpl(const KeyT &Key, const LookupKeyT &Lookup,
-                                  BucketT *the_bucket_) {
-        unsigned Newnum_entries_ = num_entries() + 1;
-        unsigned num_buckets_ = getNumBukets();
-        if (Newnum_entries_ * 4 >= num_buckets_ * 3) {
-            this->Grow(num_buckets_ * 2);
-            LookupBucketFor(Lookup, the_bucket_);
-            num_buckets_ = getNumBukets();
-        } else if (num_buckets_ - (Newnum_entries_ + num_to_mbstones()) <=
-                   num_buckets_ / 8) {
-            this->Grow(num_buckets_);
-            LookupBucketFor(Lookup, the_bucket_);
+                                  HashT Hash, BucketT *the_bucket_) {
+        size_type AtLeast;
+        if (shouldGrow(num_entries() + 1, AtLeast)) {
+            // Tombstones alone never call for a bigger table.
+            if (AtLeast != 0 && AtLeast == getNumBukets())
+                rehashInPlace();
+            else
+                this->Grow(AtLeast);
+            LookupBucketFor(Lookup, Hash, the_bucket_);
+        } else if (shouldCompact()) {
+            rehashInPlace();
+            LookupBucketFor(Lookup, Hash, the_bucket_);
         }
         assert(the_bucket_);
+        makeRoomAt(the_bucket_, MovesEntries());
 
         // Only update the state after we've Grown our bucket space
         // appropriately so that when Growing buckets we have self-consistent
@@ -488,9 +1145,201 @@ private:
         if (!KeyInfoT::IsEqual(the_bucket_->GetFirst(), EmptyKey))
             decrementnum_to_mbstones_();
 
+        ProbeT::setFull(getMetadata(), getNumBukets(),
+                        the_bucket_ - getBuckets(), Hash);
+        BucketHashTraits::SetHash(*the_bucket_, Hash);
         return the_bucket_;
     }
 
+    /// eraseBucket - Destroy the entry in \p B. The bucket becomes a
+    /// tombstone, or with a policy that moves entries, the entries after it
+    /// are shifted back over it.
+    void eraseBucket(BucketT *B, std::false_type) {
+        B->GetSecond().~ValueT();
+        B->GetFirst() = GetTombstoneKey();
+        BucketHashTraits::SetHash(*B, 0);
+        ProbeT::setDeleted(getMetadata(), getNumBukets(), B - getBuckets());
+        decrement_num_entries();
+        incrementnum_to_mbstones_();
+    }
+    void eraseBucket(BucketT *B, std::true_type) {
+        B->GetSecond().~ValueT();
+        B->GetFirst() = GetEmptyKey();
+        BucketHashTraits::SetHash(*B, 0);
+        BucketT *Buckets = getBuckets();
+        ProbeT::template shiftBackward<KeyInfoT>(
+            Buckets, getMetadata(), getNumBukets(), B - Buckets,
+            [=](size_t To, size_t From) {
+                moveBucket(Buckets[To], Buckets[From]);
+            });
+        decrement_num_entries();
+    }
+
+    /// makeRoomAt - Empty the bucket a policy that moves entries chose for
+    /// an insertion by shifting its entry and the ones after it forward.
+    void makeRoomAt(BucketT *, std::false_type) {}
+    void makeRoomAt(BucketT *B, std::true_type) {
+        if (KeyInfoT::IsEqual(B->GetFirst(), GetEmptyKey())) return;
+        BucketT *Buckets = getBuckets();
+        ProbeT::shiftForward(getMetadata(), getNumBukets(), B - Buckets,
+                             [=](size_t To, size_t From) {
+                                 moveBucket(Buckets[To], Buckets[From]);
+                             });
+    }
+
+    /// moveBucket - Move the entry in \p Src into the empty bucket \p Dst,
+    /// leaving \p Src empty.
+    static void moveBucket(BucketT &Dst, BucketT &Src) {
+        Dst.GetFirst() = std::move(Src.GetFirst());
+        ::new (&Dst.GetSecond()) ValueT(std::move(Src.GetSecond()));
+        BucketHashTraits::CopyHash(Dst, Src);
+        Src.GetSecond().~ValueT();
+        Src.GetFirst() = GetEmptyKey();
+        BucketHashTraits::SetHash(Src, 0);
+    }
+
+    /// shouldGrow - Return true if holding Newnum_entries_ entries requires a
+    /// call to Grow(AtLeast) first: either the load factor would exceed 3/4,
+    /// or fewer than 1/8 of the buckets would be left empty because of
+    /// tombstones, in which case the table is rehashed at the same size.
+    bool shouldGrow(size_type Newnum_entries_, size_type &AtLeast) const {
+        size_type num_buckets_ = getNumBukets();
+        if (Newnum_entries_ * 4 >= num_buckets_ * 3) {
+            AtLeast = num_buckets_ * 2;
+            return true;
+        }
+        if (num_buckets_ - (Newnum_entries_ + num_to_mbstones()) <=
+            num_buckets_ / 8) {
+            AtLeast = num_buckets_;
+            return true;
+        }
+        return false;
+    }
+
+    /// shouldCompact - Return true if tombstones take up more of the table
+    /// than getMaxTombstonePercent() allows.
+    bool shouldCompact() const {
+        const unsigned Percent = getMaxTombstonePercent();
+        return Percent != 0 && uint64_t(num_to_mbstones()) * 100 >
+                                   uint64_t(getNumBukets()) * Percent;
+    }
+
+    /// rehashInPlace - Drop all tombstones and move every entry to where a
+    /// fresh table of the same size would put it, within the current bucket
+    /// array.
+    ///
+    /// Live entries start out pending. Each pending entry claims the first
+    /// bucket on its probe sequence that is empty or still pending, swapping
+    /// with the pending entry found there if any. Placed entries never move
+    /// again, so every bucket ahead of an entry on its probe sequence stays
+    /// full, which is all a lookup needs. The only extra memory is one bit
+    /// per bucket to track the pending entries.
+    void rehashInPlace() {
+#if HASHMAP_ENABLE_STATS
+        StatsTimer Timer(Stats, StatsEvent::Rehash);
+#endif
+        const size_type NumBuckets = getNumBukets();
+        BucketT *Buckets = getBuckets();
+        const KeyT EmptyKey = GetEmptyKey(), TombstoneKey = GetTombstoneKey();
+
+        std::unique_ptr<uint64_t[]> Pending(
+            new uint64_t[(NumBuckets + 63) / 64]());
+        auto IsPending = [&](size_t i) {
+            return (Pending[i / 64] >> (i % 64)) & 1;
+        };
+        for (size_type i = 0; i != NumBuckets; ++i) {
+            if (KeyInfoT::IsEqual(Buckets[i].GetFirst(), EmptyKey)) continue;
+            if (KeyInfoT::IsEqual(Buckets[i].GetFirst(), TombstoneKey)) {
+                Buckets[i].GetFirst() = EmptyKey;
+                BucketHashTraits::SetHash(Buckets[i], 0);
+            } else {
+                Pending[i / 64] |= uint64_t(1) << (i % 64);
+            }
+        }
+        ProbeT::initMetadata(getMetadata(), NumBuckets);
+        set_num_to_mbstones(0);
+
+        for (size_type i = 0; i != NumBuckets; ++i) {
+            while (IsPending(i)) {
+                BucketT &B = Buckets[i];
+                const HashT Hash =
+                    BucketHashTraits::template GetHash<KeyInfoT>(B);
+                const size_t Dest = ProbeT::FindBucketIf(
+                    NumBuckets, Hash, [&](size_t j) {
+                        return IsPending(j) ||
+                               KeyInfoT::IsEqual(Buckets[j].GetFirst(),
+                                                 EmptyKey);
+                    });
+                BucketT &D = Buckets[Dest];
+                if (Dest == i) {
+                    // Already in place.
+                } else if (!IsPending(Dest)) {
+                    D.GetFirst() = std::move(B.GetFirst());
+                    ::new (&D.GetSecond()) ValueT(std::move(B.GetSecond()));
+                    BucketHashTraits::SetHash(D, Hash);
+                    B.GetSecond().~ValueT();
+                    B.GetFirst() = EmptyKey;
+                    BucketHashTraits::SetHash(B, 0);
+                    Pending[i / 64] &= ~(uint64_t(1) << (i % 64));
+                } else {
+                    // Take over Dest and carry on with its entry.
+                    std::swap(B.GetFirst(), D.GetFirst());
+                    std::swap(B.GetSecond(), D.GetSecond());
+                    BucketHashTraits::SwapHash(B, D);
+                }
+                Pending[Dest / 64] &= ~(uint64_t(1) << (Dest % 64));
+                ProbeT::setFull(getMetadata(), NumBuckets, Dest, Hash);
+            }
+        }
+        sortClusters(MovesEntries());
+    }
+
+    /// sortClusters - Restore the order a policy that moves entries keeps,
+    /// after rehashInPlace() only made every entry reachable from its home
+    /// bucket. Linear probing fills the same buckets whatever the insertion
+    /// order, so sorting each run of full buckets by home bucket is enough.
+    void sortClusters(std::false_type) {}
+    void sortClusters(std::true_type) {
+        const size_type NumBuckets = getNumBukets();
+        const size_type Mask = NumBuckets - 1;
+        BucketT *Buckets = getBuckets();
+        const KeyT EmptyKey = GetEmptyKey();
+        auto IsEmpty = [&](size_type i) {
+            return KeyInfoT::IsEqual(Buckets[i].GetFirst(), EmptyKey);
+        };
+        auto GetHash = [&](size_type i) -> HashT {
+            return BucketHashTraits::template GetHash<KeyInfoT>(Buckets[i]);
+        };
+
+        // Start right after an empty bucket, so that no run wraps around
+        // the end of the scan.
+        size_type Start = 0;
+        while (Start != NumBuckets && !IsEmpty(Start)) ++Start;
+        if (Start == NumBuckets) return;
+        size_type First = 0;  // The first bucket of the current run.
+        for (size_type k = 1; k <= NumBuckets; ++k) {
+            const size_type Pos = (Start + k) & Mask;
+            if (IsEmpty(Pos)) continue;
+            if (IsEmpty((Pos - 1) & Mask)) First = Pos;
+            // Insertion sort by home bucket, counted from the run start.
+            auto Rank = [&](size_type i) {
+                return (detail::getHomeBucket(GetHash(i), NumBuckets) - First) &
+                       Mask;
+            };
+            const size_type R = Rank(Pos);
+            for (size_type i = Pos; i != First && Rank((i - 1) & Mask) > R;
+                 i = (i - 1) & Mask) {
+                BucketT &B = Buckets[i], &D = Buckets[(i - 1) & Mask];
+                std::swap(B.GetFirst(), D.GetFirst());
+                std::swap(B.GetSecond(), D.GetSecond());
+                BucketHashTraits::SwapHash(B, D);
+            }
+        }
+        for (size_type i = 0; i != NumBuckets; ++i)
+            if (!IsEmpty(i))
+                ProbeT::setFull(getMetadata(), NumBuckets, i, GetHash(i));
+    }
+
     /// LookupBucketFor - Lookup the appropriate bucket for Val, returning it in
     /// FoundBucket.  If the bucket contains the key and a value, this returns
     /// true, otherwise it returns a bucket with an empty marker or tombstone
@@ -498,55 +1347,30 @@ private:
     template <typename LookupKeyT>
     bool LookupBucketFor(const LookupKeyT &Val,
                          const BucketT *&FoundBucket) const {
-        const BucketT *Bucketsptr = getBuckets();
-        const unsigned num_buckets_ = getNumBukets();
-
-        if (num_buckets_ == 0) {
+        if (getNumBukets() == 0) {
             FoundBucket = nullptr;
             return false;
         }
+        return LookupBucketFor(Val, GetHashValue(Val), FoundBucket);
+    }
 
-        // FoundTombstone - Keep track of whether we find a tombstone while
-        // probing.
-        const BucketT *FoundTombstone = nullptr;
-        const KeyT EmptyKey = GetEmptyKey();
-        const KeyT TombstoneKey = GetTombstoneKey();
-        assert(!KeyInfoT::IsEqual(Val, EmptyKey) &&
-               !KeyInfoT::IsEqual(Val, TombstoneKey) &&
-               "Empty/Tombstone value shouldn't be inserted into map!");
-
-        unsigned BucketNo = GetHashValue(Val) & (num_buckets_ - 1);
-        unsigned ProbeAmt = 1;
-        while (true) {
-            const BucketT *ThisBucket = Bucketsptr + BucketNo;
-            // Found Val's bucket?  If so, return it.
-            if (KeyInfoT::IsEqual(Val, ThisBucket->GetFirst())) {
-                FoundBucket = ThisBucket;
-                return true;
-            }
-
-            // If we found an empty bucket, the key doesn't exist in the set.
-            // Insert it and return the default value.
-            if (KeyInfoT::IsEqual(ThisBucket->GetFirst(), EmptyKey)) {
-                // If we've already seen a tombstone while probing, fill it in
-                // instead of the empty bucket we eventually probed to.
-                FoundBucket = FoundTombstone ? FoundTombstone : ThisBucket;
-                return false;
-            }
-
-            // If this is a tombstone, remember it.  If Val ends up not in the
-            // map, we prefer to return it than something that would require
-            // more probing.
-            if (KeyInfoT::IsEqual(ThisBucket->GetFirst(), TombstoneKey) &&
-                !FoundTombstone)
-                FoundTombstone =
-                    ThisBucket;  // Remember the first tombstone found.
-
-            // Otherwise, it's a hash collision or a tombstone, continue
-            // quadratic probing.
-            BucketNo += ProbeAmt++;
-            BucketNo &= (num_buckets_ - 1);
+    /// Same as above, for callers that already computed the hash of Val.
+    template <typename LookupKeyT>
+    bool LookupBucketFor(const LookupKeyT &Val, HashT Hash,
+                         const BucketT *&FoundBucket) const {
+        if (getNumBukets() == 0) {
+            FoundBucket = nullptr;
+            return false;
         }
+        assert(!KeyInfoT::IsEqual(Val, GetEmptyKey()) &&
+               !KeyInfoT::IsEqual(Val, GetTombstoneKey()) &&
+               "Empty/Tombstone value shouldn't be inserted into map!");
+#if HASHMAP_ENABLE_STATS
+        recordProbes(Val, Hash);
+#endif
+        return ProbeT::template LookupBucketFor<KeyInfoT>(
+            getBuckets(), getMetadata(), getNumBukets(), Val, Hash,
+            FoundBucket);
     }
 
     template <typename LookupKeyT>
@@ -558,40 +1382,95 @@ private:
         return Result;
     }
 
+    template <typename LookupKeyT>
+    bool LookupBucketFor(const LookupKeyT &Val, HashT Hash,
+                         BucketT *&FoundBucket) {
+        const BucketT *ConstFoundBucket;
+        bool Result = const_cast<const HashMapBase *>(this)->LookupBucketFor(
+            Val, Hash, ConstFoundBucket);
+        FoundBucket = const_cast<BucketT *>(ConstFoundBucket);
+        return Result;
+    }
+
 public:
     /// Return the approximate size (in bytes) of the actual map.
     /// This is just the raw memory used by HashMap.
     /// If entries are pointers to objects, the size of the referenced objects
     /// are not included.
-    size_t getMemorySize() const { return getNumBukets() * sizeof(BucketT); }
+    size_t getMemorySize() const {
+        return getNumBukets() * sizeof(BucketT) +
+               ProbeT::getMetadataSize(getNumBukets());
+    }
+
+    /// Return the number of buckets in the table, empty ones included.
+    size_type getNumBuckets() const { return getNumBukets(); }
 };
 
+/// HashMap - The bucket array lives on the heap and is obtained from
+/// \p AllocatorT, which may be stateful (an arena, a NUMA node, a
+/// std::pmr::polymorphic_allocator). swap() and move assignment hand the
+/// buckets over to the other map, so they exchange allocators if the
+/// allocator propagates on swap and otherwise require equal ones. Copy
+/// assignment keeps the map's own allocator.
+///
+/// If the allocator can resize a block without copying it, as
+/// HugePageAllocator does with mremap, Grow() resizes the bucket array of
+/// trivially copyable keys and values in place and rehashes within it.
 template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
-          typename BucketT = detail::HashMapPair<KeyT, ValueT>>
-class HashMap : public HashMapBase<HashMap<KeyT, ValueT, KeyInfoT, BucketT>,
-                                   KeyT, ValueT, KeyInfoT, BucketT> {
-    friend class HashMapBase<HashMap, KeyT, ValueT, KeyInfoT, BucketT>;
+          typename BucketT = detail::HashMapPair<KeyT, ValueT>,
+          typename ProbeT = QuadraticProbing,
+          typename AllocatorT = std::allocator<BucketT>>
+class HashMap
+    : public HashMapBase<
+          HashMap<KeyT, ValueT, KeyInfoT, BucketT, ProbeT, AllocatorT>, KeyT,
+          ValueT, KeyInfoT, BucketT, ProbeT>,
+      private detail::BucketAllocator<BucketT, ProbeT, AllocatorT> {
+    friend class HashMapBase<HashMap, KeyT, ValueT, KeyInfoT, BucketT, ProbeT>;
+    template <typename, typename, typename, typename, typename>
+    friend class IncrementalHashMap;
 
     // Lift some types from the dependent base class into this class for
     // simplicity of referring to them.
-    using BaseT = HashMapBase<HashMap, KeyT, ValueT, KeyInfoT, BucketT>;
+    using BaseT = HashMapBase<HashMap, KeyT, ValueT, KeyInfoT, BucketT, ProbeT>;
+    using AllocBaseT = detail::BucketAllocator<BucketT, ProbeT, AllocatorT>;
 
     BucketT *Buckets;
-    unsigned num_entries_;
-    unsigned num_to_mbstones_;
-    unsigned num_buckets_;
+    typename BaseT::size_type num_entries_;
+    typename BaseT::size_type num_to_mbstones_;
+    typename BaseT::size_type num_buckets_;
+    uint8_t MaxTombstonePercent = BaseT::DefaultMaxTombstonePercent;
+    unsigned GrowThreads = 1;
 
 public:
+    using allocator_type = AllocatorT;
+    // The allocator base declares these too; the map's own win.
+    using size_type = typename BaseT::size_type;
+    using value_type = typename BaseT::value_type;
+
     /// Create a HashMap wth an optional \p InitialReserve that guarantee that
     /// this number of elements can be inserted in the map without Grow()
-    explicit HashMap(unsigned InitialReserve = 0) { init(InitialReserve); }
+    explicit HashMap(size_type InitialReserve = 0) { init(InitialReserve); }
+
+    /// Same as above, taking the bucket arrays from \p Alloc.
+    HashMap(size_type InitialReserve, const AllocatorT &Alloc)
+        : AllocBaseT(Alloc) {
+        init(InitialReserve);
+    }
 
-    HashMap(const HashMap &other) : BaseT() {
+    explicit HashMap(const AllocatorT &Alloc) : HashMap(0, Alloc) {}
+
+    HashMap(const HashMap &other)
+        : BaseT(),
+          AllocBaseT(std::allocator_traits<AllocatorT>::
+                         select_on_container_copy_construction(
+                             other.get_allocator())),
+          MaxTombstonePercent(other.MaxTombstonePercent),
+          GrowThreads(other.GrowThreads) {
         init(0);
         CopyFrom(other);
     }
 
-    HashMap(HashMap &&other) : BaseT() {
+    HashMap(HashMap &&other) : BaseT(), AllocBaseT(other.get_allocator()) {
         init(0);
         swap(other);
     }
@@ -604,14 +1483,31 @@ public:
 
     ~HashMap() {
         this->DestroyAll();
-        operator delete(Buckets);
+        this->deallocateBucketArray(Buckets, num_buckets_);
+    }
+
+    AllocatorT get_allocator() const { return this->getAllocator(); }
+
+    /// setGrowThreads - Let Grow() rehash a large table on up to
+    /// \p NumThreads threads, the calling one included. 1, the default,
+    /// rehashes on the calling thread only. Tables grown in place by the
+    /// allocator, and policies that move entries, are always rehashed
+    /// serially.
+    void setGrowThreads(unsigned NumThreads) {
+        assert(NumThreads != 0 && "Need a thread to grow on!");
+        GrowThreads = NumThreads;
     }
 
+    unsigned getGrowThreads() const { return GrowThreads; }
+
     void swap(HashMap &RHS) {
         std::swap(Buckets, RHS.Buckets);
         std::swap(num_entries_, RHS.num_entries_);
         std::swap(num_to_mbstones_, RHS.num_to_mbstones_);
         std::swap(num_buckets_, RHS.num_buckets_);
+        std::swap(MaxTombstonePercent, RHS.MaxTombstonePercent);
+        std::swap(GrowThreads, RHS.GrowThreads);
+        this->swapAllocator(RHS);
     }
 
     HashMap &operator=(const HashMap &other) {
@@ -621,7 +1517,7 @@ public:
 
     HashMap &operator=(HashMap &&other) {
         this->DestroyAll();
-        operator delete(Buckets);
+        this->deallocateBucketArray(Buckets, num_buckets_);
         init(0);
         swap(other);
         return *this;
@@ -629,7 +1525,9 @@ public:
 
     void CopyFrom(const HashMap &other) {
         this->DestroyAll();
-        operator delete(Buckets);
+        this->deallocateBucketArray(Buckets, num_buckets_);
+        MaxTombstonePercent = other.MaxTombstonePercent;
+        GrowThreads = other.GrowThreads;
         if (AllocateBuckets(other.num_buckets_)) {
             this->BaseT::CopyFrom(other);
         } else {
@@ -638,7 +1536,7 @@ public:
         }
     }
 
-    void init(unsigned Initnum_entries_) {
+    void init(size_type Initnum_entries_) {
         auto InitBuckets =
             BaseT::getMinBucketToReserveForEntries(Initnum_entries_);
         if (AllocateBuckets(InitBuckets)) {
@@ -649,80 +1547,119 @@ public:
         }
     }
 
-    void Grow(unsigned AtLeast) {
-        unsigned Oldnum_buckets_ = num_buckets_;
+    void Grow(size_type AtLeast) {
+        size_type Oldnum_buckets_ = num_buckets_;
         BucketT *OldBuckets = Buckets;
+        const size_type Newnum_buckets_ = std::max<size_type>(
+            64, static_cast<size_type>(NextPowerOf2(AtLeast - 1)));
+
+        // Entries that can be moved bitwise survive the allocator remapping
+        // the array, so they only need to be redistributed within it.
+        if (OldBuckets && Newnum_buckets_ > Oldnum_buckets_ &&
+            isPodLike<KeyT>::value && isPodLike<ValueT>::value) {
+            if (BucketT *NewBuckets = this->reallocateBucketArray(
+                    OldBuckets, Oldnum_buckets_, Newnum_buckets_)) {
+                Buckets = NewBuckets;
+                num_buckets_ = Newnum_buckets_;
+                this->moveWithinBuckets(Oldnum_buckets_);
+                return;
+            }
+        }
 
-        AllocateBuckets(std::max<unsigned>(
-            64, static_cast<unsigned>(NextPowerOf2(AtLeast - 1))));
+        AllocateBuckets(Newnum_buckets_);
         assert(Buckets);
         if (!OldBuckets) {
             this->BaseT::initEmpty();
             return;
         }
 
-        this->moveFromOldBuckets(OldBuckets, OldBuckets + Oldnum_buckets_);
+        this->moveFromOldBuckets(OldBuckets, OldBuckets + Oldnum_buckets_,
+                                 GrowThreads);
 
         // Free the old table.
-        operator delete(OldBuckets);
+        this->deallocateBucketArray(OldBuckets, Oldnum_buckets_);
     }
 
     void shrink_and_clear() {
-        unsigned Oldnum_entries_ = num_entries_;
+        size_type Oldnum_entries_ = num_entries_;
         this->DestroyAll();
 
         // Reduce the number of buckets.
-        unsigned Newnum_buckets_ = 0;
+        size_type Newnum_buckets_ = 0;
         if (Oldnum_entries_)
-            Newnum_buckets_ =
-                std::max(64, 1 << (Log2_32_Ceil(Oldnum_entries_) + 1));
+            Newnum_buckets_ = std::max<size_type>(
+                64,
+                static_cast<size_type>(NextPowerOf2(Oldnum_entries_ - 1)) * 2);
         if (Newnum_buckets_ == num_buckets_) {
             this->BaseT::initEmpty();
             return;
         }
 
-        operator delete(Buckets);
+        this->deallocateBucketArray(Buckets, num_buckets_);
         init(Newnum_buckets_);
     }
 
 private:
-    unsigned num_entries() const { return num_entries_; }
+    size_type num_entries() const { return num_entries_; }
 
-    void set_num_entries(unsigned Num) { num_entries_ = Num; }
+    void set_num_entries(size_type Num) { num_entries_ = Num; }
 
-    unsigned num_to_mbstones() const { return num_to_mbstones_; }
+    size_type num_to_mbstones() const { return num_to_mbstones_; }
 
-    void set_num_to_mbstones(unsigned Num) { num_to_mbstones_ = Num; }
+    void set_num_to_mbstones(size_type Num) { num_to_mbstones_ = Num; }
+
+    unsigned max_tombstone_percent() const { return MaxTombstonePercent; }
+
+    void set_max_tombstone_percent(unsigned Percent) {
+        MaxTombstonePercent = Percent;
+    }
 
     BucketT *getBuckets() const { return Buckets; }
 
-    unsigned getNumBukets() const { return num_buckets_; }
+    size_type getNumBukets() const { return num_buckets_; }
 
-    bool AllocateBuckets(unsigned Num) {
+    bool AllocateBuckets(size_type Num) {
         num_buckets_ = Num;
         if (num_buckets_ == 0) {
             Buckets = nullptr;
             return false;
         }
 
-        Buckets = static_cast<BucketT *>(operator new(sizeof(BucketT) *
-                                                      num_buckets_));
+        Buckets = this->allocateBucketArray(num_buckets_);
         return true;
     }
+
+    /// Take ownership of \p NewBuckets, an array of \p Num buckets whose keys
+    /// and metadata are already initialized to empty.
+    void adoptBuckets(BucketT *NewBuckets, size_type Num) {
+        assert(!Buckets && "Would leak the current table!");
+        Buckets = NewBuckets;
+        num_buckets_ = Num;
+        num_entries_ = 0;
+        num_to_mbstones_ = 0;
+    }
 };
 
+/// SmallHashMap - Keeps up to \p InlineBuckets buckets inside the object and
+/// only takes a bucket array from \p AllocatorT once it outgrows them.
 template <typename KeyT, typename ValueT, unsigned InlineBuckets = 4,
           typename KeyInfoT = HashMapInfo<KeyT>,
-          typename BucketT = detail::HashMapPair<KeyT, ValueT>>
+          typename BucketT = detail::HashMapPair<KeyT, ValueT>,
+          typename ProbeT = QuadraticProbing,
+          typename AllocatorT = std::allocator<BucketT>>
 class SmallHashMap
-    : public HashMapBase<
-          SmallHashMap<KeyT, ValueT, InlineBuckets, KeyInfoT, BucketT>, KeyT,
-          ValueT, KeyInfoT, BucketT> {
-    friend class HashMapBase<SmallHashMap, KeyT, ValueT, KeyInfoT, BucketT>;
+    : public HashMapBase<SmallHashMap<KeyT, ValueT, InlineBuckets, KeyInfoT,
+                                      BucketT, ProbeT, AllocatorT>,
+                         KeyT, ValueT, KeyInfoT, BucketT, ProbeT>,
+      private detail::BucketAllocator<BucketT, ProbeT, AllocatorT> {
+    friend class HashMapBase<SmallHashMap, KeyT, ValueT, KeyInfoT, BucketT,
+                             ProbeT>;
 
     // Lift some types from the dependent base class into this class for
     // simplicity of referring to them.
-    using BaseT = HashMapBase<SmallHashMap, KeyT, ValueT, KeyInfoT, BucketT>;
+    using BaseT =
+        HashMapBase<SmallHashMap, KeyT, ValueT, KeyInfoT, BucketT, ProbeT>;
+    using AllocBaseT = detail::BucketAllocator<BucketT, ProbeT, AllocatorT>;
 
     static_assert(isPowerOf2_64(InlineBuckets),
                   "InlineBuckets must be a power of 2.");
@@ -730,23 +1667,47 @@ class SmallHashMap
     unsigned Small : 1;
     unsigned num_entries_ : 31;
     unsigned num_to_mbstones_;
+    uint8_t MaxTombstonePercent = BaseT::DefaultMaxTombstonePercent;
 
     struct LargeRep {
         BucketT *Buckets;
         unsigned num_buckets_;
     };
 
-    AlignedCharArrayUnion<BucketT[InlineBuckets], LargeRep> storage;
+    AlignedCharArrayUnion<
+        detail::InlineBucketStorage<BucketT, InlineBuckets,
+                                    ProbeT::getMetadataSize(InlineBuckets)>,
+        LargeRep>
+        storage;
 
 public:
+    using allocator_type = AllocatorT;
+    // The allocator base declares these too; the map's own win.
+    using size_type = typename BaseT::size_type;
+    using value_type = typename BaseT::value_type;
+
     explicit SmallHashMap(unsigned NumInitBuckets = 0) { init(NumInitBuckets); }
 
-    SmallHashMap(const SmallHashMap &other) : BaseT() {
+    /// Same as above, taking any out-of-line bucket array from \p Alloc.
+    SmallHashMap(unsigned NumInitBuckets, const AllocatorT &Alloc)
+        : AllocBaseT(Alloc) {
+        init(NumInitBuckets);
+    }
+
+    explicit SmallHashMap(const AllocatorT &Alloc) : SmallHashMap(0, Alloc) {}
+
+    SmallHashMap(const SmallHashMap &other)
+        : BaseT(),
+          AllocBaseT(std::allocator_traits<AllocatorT>::
+                         select_on_container_copy_construction(
+                             other.get_allocator())),
+          MaxTombstonePercent(other.MaxTombstonePercent) {
         init(0);
         CopyFrom(other);
     }
 
-    SmallHashMap(SmallHashMap &&other) : BaseT() {
+    SmallHashMap(SmallHashMap &&other)
+        : BaseT(), AllocBaseT(other.get_allocator()) {
         init(0);
         swap(other);
     }
@@ -762,11 +1723,17 @@ public:
         DeallocateBuckets();
     }
 
+    AllocatorT get_allocator() const { return this->getAllocator(); }
+
     void swap(SmallHashMap &RHS) {
+        // Any out-of-line buckets travel with the allocator that owns them.
+        this->swapAllocator(RHS);
+
         unsigned Tmpnum_entries_ = RHS.num_entries_;
         RHS.num_entries_ = num_entries_;
         num_entries_ = Tmpnum_entries_;
         std::swap(num_to_mbstones_, RHS.num_to_mbstones_);
+        std::swap(MaxTombstonePercent, RHS.MaxTombstonePercent);
 
         const KeyT EmptyKey = this->GetEmptyKey();
         const KeyT TombstoneKey = this->GetTombstoneKey();
@@ -787,6 +1754,7 @@ public:
                 }
                 // Swap separately and handle any assymetry.
                 std::swap(LHSB->GetFirst(), RHSB->GetFirst());
+                BaseT::BucketHashTraits::SwapHash(*LHSB, *RHSB);
                 if (hasLHSValue) {
                     ::new (&RHSB->GetSecond())
                         ValueT(std::move(LHSB->GetSecond()));
@@ -797,6 +1765,10 @@ public:
                     RHSB->GetSecond().~ValueT();
                 }
             }
+            std::swap_ranges(this->getMetadata(),
+                             this->getMetadata() +
+                                 ProbeT::getMetadataSize(InlineBuckets),
+                             RHS.getMetadata());
             return;
         }
         if (!Small && !RHS.Small) {
@@ -821,6 +1793,7 @@ public:
             BucketT *NewB = &LargeSide.getInlineBuckets()[i],
                     *OldB = &SmallSide.getInlineBuckets()[i];
             ::new (&NewB->GetFirst()) KeyT(std::move(OldB->GetFirst()));
+            BaseT::BucketHashTraits::CopyHash(*NewB, *OldB);
             OldB->GetFirst().~KeyT();
             if (!KeyInfoT::IsEqual(NewB->GetFirst(), EmptyKey) &&
                 !KeyInfoT::IsEqual(NewB->GetFirst(), TombstoneKey)) {
@@ -828,6 +1801,9 @@ public:
                 OldB->GetSecond().~ValueT();
             }
         }
+        if (ProbeT::UsesMetadata)
+            std::memcpy(LargeSide.getMetadata(), SmallSide.getMetadata(),
+                        ProbeT::getMetadataSize(InlineBuckets));
 
         // The hard part of moving the small buckets across is done, just move
         // the TmpRep into its new home.
@@ -851,6 +1827,7 @@ public:
     void CopyFrom(const SmallHashMap &other) {
         this->DestroyAll();
         DeallocateBuckets();
+        MaxTombstonePercent = other.MaxTombstonePercent;
         Small = true;
         if (other.getNumBukets() > InlineBuckets) {
             Small = false;
@@ -892,6 +1869,7 @@ public:
                     assert(size_t(Tmpend - TmpBegin) < InlineBuckets &&
                            "Too many inline buckets!");
                     ::new (&Tmpend->GetFirst()) KeyT(std::move(P->GetFirst()));
+                    BaseT::BucketHashTraits::CopyHash(*Tmpend, *P);
                     ::new (&Tmpend->GetSecond())
                         ValueT(std::move(P->GetSecond()));
                     ++Tmpend;
@@ -920,7 +1898,7 @@ public:
                                  OldRep.Buckets + OldRep.num_buckets_);
 
         // Free the old table.
-        operator delete(OldRep.Buckets);
+        this->deallocateBucketArray(OldRep.Buckets, OldRep.num_buckets_);
     }
 
     void shrink_and_clear() {
@@ -957,6 +1935,12 @@ private:
 
     void set_num_to_mbstones(unsigned Num) { num_to_mbstones_ = Num; }
 
+    unsigned max_tombstone_percent() const { return MaxTombstonePercent; }
+
+    void set_max_tombstone_percent(unsigned Percent) {
+        MaxTombstonePercent = Percent;
+    }
+
     const BucketT *getInlineBuckets() const {
         assert(Small);
         return reinterpret_cast<const BucketT *>(storage.buffer);
@@ -993,26 +1977,34 @@ private:
     void DeallocateBuckets() {
         if (Small) return;
 
-        operator delete(getLargeRep()->Buckets);
+        this->deallocateBucketArray(getLargeRep()->Buckets,
+                                    getLargeRep()->num_buckets_);
         getLargeRep()->~LargeRep();
     }
 
     LargeRep AllocateBuckets(unsigned Num) {
         assert(Num > InlineBuckets &&
                "Must Allocate more buckets than are inline");
-        LargeRep Rep = {
-            static_cast<BucketT *>(operator new(sizeof(BucketT) * Num)), Num};
+        LargeRep Rep = {this->allocateBucketArray(Num), Num};
         return Rep;
     }
 };
 
+/// HashMapIterator - Walks the buckets of a map up to \p end, the end of its
+/// bucket array, stopping at those that hold an entry. With
+/// HasOccupancyBitmap, the map's probing policy keeps a
+/// detail::OccupancyBits bitmap at \p end, which the iterator follows from
+/// one entry to the next instead of checking the key of every bucket.
 template <typename KeyT, typename ValueT, typename KeyInfoT, typename Bucket,
-          bool IsConst>
+          bool IsConst, bool HasOccupancyBitmap>
 class HashMapIterator {
-    friend class HashMapIterator<KeyT, ValueT, KeyInfoT, Bucket, true>;
-    friend class HashMapIterator<KeyT, ValueT, KeyInfoT, Bucket, false>;
+    friend class HashMapIterator<KeyT, ValueT, KeyInfoT, Bucket, true,
+                                 HasOccupancyBitmap>;
+    friend class HashMapIterator<KeyT, ValueT, KeyInfoT, Bucket, false,
+                                 HasOccupancyBitmap>;
 
-    using ConstIterator = HashMapIterator<KeyT, ValueT, KeyInfoT, Bucket, true>;
+    using ConstIterator = HashMapIterator<KeyT, ValueT, KeyInfoT, Bucket, true,
+                                          HasOccupancyBitmap>;
 
 public:
     using difference_type = ptrdiff_t;
@@ -1037,8 +2029,8 @@ public:
 
     template <bool IsConstSrc,
               typename = typename std::enable_if<!IsConstSrc && IsConst>::type>
-    HashMapIterator(
-        const HashMapIterator<KeyT, ValueT, KeyInfoT, Bucket, IsConstSrc> &I)
+    HashMapIterator(const HashMapIterator<KeyT, ValueT, KeyInfoT, Bucket,
+                                          IsConstSrc, HasOccupancyBitmap> &I)
         : ptr(I.ptr), end(I.end) {}
 
     reference operator*() const { return *ptr; }
@@ -1060,6 +2052,19 @@ public:
 
 private:
     void AdvancePastEmptyBuckets() {
+        AdvancePastEmptyBuckets(
+            std::integral_constant<bool, HasOccupancyBitmap>());
+    }
+
+    void AdvancePastEmptyBuckets(std::true_type) {
+        assert(ptr <= end);
+        if (ptr == end) return;
+        const size_t D = detail::OccupancyBits::findNext(
+            reinterpret_cast<const uint8_t *>(end), end - ptr);
+        ptr = end - D;
+    }
+
+    void AdvancePastEmptyBuckets(std::false_type) {
         assert(ptr <= end);
         const KeyT Empty = KeyInfoT::GetEmptyKey();
         const KeyT Tombstone = KeyInfoT::GetTombstoneKey();
@@ -1079,3 +2084,26 @@ private:
             --ptr;
     }
 };
+
+#ifdef HASHMAP_HAVE_PMR
+namespace pmr {
+
+/// HashMap and SmallHashMap with their buckets in a std::pmr::memory_resource.
+/// With a std::pmr::monotonic_buffer_resource per request, releasing the
+/// resource frees every map of the request at once.
+template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
+          typename BucketT = detail::HashMapPair<KeyT, ValueT>,
+          typename ProbeT = QuadraticProbing>
+using HashMap = ::HashMap<KeyT, ValueT, KeyInfoT, BucketT, ProbeT,
+                          std::pmr::polymorphic_allocator<BucketT>>;
+
+template <typename KeyT, typename ValueT, unsigned InlineBuckets = 4,
+          typename KeyInfoT = HashMapInfo<KeyT>,
+          typename BucketT = detail::HashMapPair<KeyT, ValueT>,
+          typename ProbeT = QuadraticProbing>
+using SmallHashMap =
+    ::SmallHashMap<KeyT, ValueT, InlineBuckets, KeyInfoT, BucketT, ProbeT,
+                   std::pmr::polymorphic_allocator<BucketT>>;
+
+}  // end namespace pmr
+#endif
@@ -1,9 +1,53 @@
 #pragma once
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <string>
 #include <utility>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 #include "densemap/hashing.h"
 #include "common/type_traits.h"
+
+// Integer mixers.
+//
+// The map takes the home bucket from the low bits of a 32-bit hash, so an
+// integer hash has to carry every bit of the key down into them. Otherwise
+// keys that differ only in their high bits, like timestamps, shifted ids or
+// page-aligned addresses, pile up in a few home buckets. Each mixer turns
+// the key, widened to 64 bits, into such a hash; MixedHashMapInfo selects
+// one for an integer or pointer key.
+
+/// FibonacciMix - Fibonacci hashing: fold the high half of the key onto the
+/// low half, multiply by 2^64 / phi and keep the top half of the product.
+/// One multiply, and the default of the integer and pointer key infos.
+struct FibonacciMix {
+    static unsigned mix(uint64_t Val) {
+        Val ^= Val >> 32;
+        return static_cast<unsigned>((Val * 0x9E3779B97F4A7C15ULL) >> 32);
+    }
+};
+
+/// HashIntegerMix - hash_integer_value() from hashing.h. Slower than
+/// FibonacciMix, but every bit of the key affects every bit of the hash.
+struct HashIntegerMix {
+    static unsigned mix(uint64_t Val) {
+        return static_cast<unsigned>(
+            hashing::detail::hash_integer_value(Val));
+    }
+};
+
+/// Multiply37Mix - The Val * 37 the integer key infos used to hash with,
+/// which keeps keys differing only above the bucket mask together. Only
+/// for maps whose hashes must not change, like saved images.
+struct Multiply37Mix {
+    static unsigned mix(uint64_t Val) {
+        return static_cast<unsigned>(Val * 37ULL);
+    }
+};
+
 template <typename T>
 struct HashMapInfo {
      static inline T GetEmptyKey();
@@ -28,8 +72,7 @@ struct HashMapInfo<T*> {
     }
 
     static unsigned GetHashValue(const T* PtrVal) {
-        return (unsigned((uintptr_t)PtrVal) >> 4) ^
-               (unsigned((uintptr_t)PtrVal) >> 9);
+        return FibonacciMix::mix(reinterpret_cast<uintptr_t>(PtrVal));
     }
 
     static bool IsEqual(const T* lhs, const T* rhs) { return lhs == rhs; }
@@ -40,7 +83,9 @@ template <>
 struct HashMapInfo<char> {
     static inline char GetEmptyKey() { return ~0; }
     static inline char GetTombstoneKey() { return ~0 - 1; }
-    static unsigned GetHashValue(const char& Val) { return Val * 37U; }
+    static unsigned GetHashValue(const char& Val) {
+        return FibonacciMix::mix(Val);
+    }
 
     static bool IsEqual(const char& lhs, const char& rhs) { return lhs == rhs; }
 };
@@ -51,7 +96,7 @@ struct HashMapInfo<unsigned short> {
     static inline unsigned short GetEmptyKey() { return 0xFFFF; }
     static inline unsigned short GetTombstoneKey() { return 0xFFFF - 1; }
     static unsigned GetHashValue(const unsigned short& Val) {
-        return Val * 37U;
+        return FibonacciMix::mix(Val);
     }
 
     static bool IsEqual(const unsigned short& lhs, const unsigned short& rhs) {
@@ -64,7 +109,9 @@ template <>
 struct HashMapInfo<unsigned> {
     static inline unsigned GetEmptyKey() { return ~0U; }
     static inline unsigned GetTombstoneKey() { return ~0U - 1; }
-    static unsigned GetHashValue(const unsigned& Val) { return Val * 37U; }
+    static unsigned GetHashValue(const unsigned& Val) {
+        return FibonacciMix::mix(Val);
+    }
 
     static bool IsEqual(const unsigned& lhs, const unsigned& rhs) {
         return lhs == rhs;
@@ -78,7 +125,7 @@ struct HashMapInfo<unsigned long> {
     static inline unsigned long GetTombstoneKey() { return ~0UL - 1L; }
 
     static unsigned GetHashValue(const unsigned long& Val) {
-        return (unsigned)(Val * 37UL);
+        return FibonacciMix::mix(Val);
     }
 
     static bool IsEqual(const unsigned long& lhs, const unsigned long& rhs) {
@@ -93,7 +140,7 @@ struct HashMapInfo<unsigned long long> {
     static inline unsigned long long GetTombstoneKey() { return ~0ULL - 1ULL; }
 
     static unsigned GetHashValue(const unsigned long long& Val) {
-        return (unsigned)(Val * 37ULL);
+        return FibonacciMix::mix(Val);
     }
 
     static bool IsEqual(const unsigned long long& lhs,
@@ -107,7 +154,9 @@ template <>
 struct HashMapInfo<short> {
     static inline short GetEmptyKey() { return 0x7FFF; }
     static inline short GetTombstoneKey() { return -0x7FFF - 1; }
-    static unsigned GetHashValue(const short& Val) { return Val * 37U; }
+    static unsigned GetHashValue(const short& Val) {
+        return FibonacciMix::mix(Val);
+    }
     static bool IsEqual(const short& lhs, const short& rhs) {
         return lhs == rhs;
     }
@@ -119,7 +168,7 @@ struct HashMapInfo<int> {
     static inline int GetEmptyKey() { return 0x7fffffff; }
     static inline int GetTombstoneKey() { return -0x7fffffff - 1; }
     static unsigned GetHashValue(const int& Val) {
-        return (unsigned)(Val * 37U);
+        return FibonacciMix::mix(Val);
     }
 
     static bool IsEqual(const int& lhs, const int& rhs) { return lhs == rhs; }
@@ -135,7 +184,7 @@ struct HashMapInfo<long> {
     static inline long GetTombstoneKey() { return GetEmptyKey() - 1L; }
 
     static unsigned GetHashValue(const long& Val) {
-        return (unsigned)(Val * 37UL);
+        return FibonacciMix::mix(Val);
     }
 
     static bool IsEqual(const long& lhs, const long& rhs) { return lhs == rhs; }
@@ -150,7 +199,7 @@ struct HashMapInfo<long long> {
     }
 
     static unsigned GetHashValue(const long long& Val) {
-        return (unsigned)(Val * 37ULL);
+        return FibonacciMix::mix(Val);
     }
 
     static bool IsEqual(const long long& lhs, const long long& rhs) {
@@ -158,6 +207,27 @@ struct HashMapInfo<long long> {
     }
 };
 
+/// MixedHashMapInfo - HashMapInfo<T> for an integer or pointer T, hashing
+/// the key with the mixer \p MixT instead of the default FibonacciMix.
+template <typename T, typename MixT = FibonacciMix>
+struct MixedHashMapInfo : HashMapInfo<T> {
+    static_assert(std::is_integral<T>::value || std::is_pointer<T>::value,
+                  "Only integer and pointer keys can be mixed!");
+
+    static unsigned GetHashValue(const T &Val) { return mix(Val); }
+
+private:
+    template <typename U>
+    static unsigned mix(U Val) {
+        return MixT::mix(static_cast<uint64_t>(Val));
+    }
+
+    template <typename U>
+    static unsigned mix(U *Val) {
+        return MixT::mix(reinterpret_cast<uintptr_t>(Val));
+    }
+};
+
 // Provide HashMapInfo for all pairs whose members have info.
 template <typename T, typename U>
 struct HashMapInfo<std::pair<T, U>> {
@@ -196,33 +266,77 @@ struct HashMapInfo<std::pair<T, U>> {
 };
 
 // Provide HashMapInfo for std::strings.
+//
+/// StringLookupKey - A string given by pointer and length, to look up a
+/// std::string key without building one. Unlike a const char * it needs no
+/// terminator and may hold NUL bytes; it is the C++11 std::string_view.
+struct StringLookupKey {
+    const char *Data;
+    size_t Length;
+
+    StringLookupKey(const char *Data, size_t Length)
+        : Data(Data), Length(Length) {}
+
+    explicit operator std::string() const { return std::string(Data, Length); }
+};
+
+// A std::string can't hold an out-of-band pointer the way StringRef-style
+// keys do, so the empty and tombstone keys are two reserved byte strings.
+// Both fit in the small-string buffer and are compared by length first, so
+// probing never allocates. Keys can also be looked up without building a
+// std::string through find_as()/try_emplace_as() with a const char *, a
+// StringLookupKey or, in C++17, a std::string_view.
 template <>
 struct HashMapInfo<std::string> {
     static inline std::string GetEmptyKey() {
-        return std::string(
-            reinterpret_cast<const char*>(~static_cast<uintptr_t>(0)), 0);
+        return std::string("\xFF\0HashMapEmpty", 14);
     }
 
     static inline std::string GetTombstoneKey() {
-        return std::string(
-            reinterpret_cast<const char*>(~static_cast<uintptr_t>(1)), 0);
+        return std::string("\xFF\0HashMapTomb", 13);
+    }
+
+    static unsigned GetHashValue(const std::string &Val) {
+        assert(Val != GetEmptyKey() && "Cannot hash the empty key!");
+        assert(Val != GetTombstoneKey() && "Cannot hash the tombstone key!");
+        return GetHashValue(Val.data(), Val.size());
+    }
+
+    static unsigned GetHashValue(const char *Val) {
+        return GetHashValue(Val, std::strlen(Val));
     }
 
-    static unsigned GetHashValue(std::string Val) {
-        assert(Val.data() != GetEmptyKey().data() &&
-               "Cannot hash the empty key!");
-        assert(Val.data() != GetTombstoneKey().data() &&
-               "Cannot hash the tombstone key!");
-        return (unsigned)(hash_value(Val));
+    /// Hash \p Length bytes at \p Data, consistently with the std::string
+    /// holding them.
+    static unsigned GetHashValue(const char *Data, size_t Length) {
+        return (unsigned)hash_combine_range(Data, Data + Length);
     }
 
-    static bool IsEqual(std::string lhs, std::string rhs) {
-        if (rhs.data() == GetEmptyKey().data())
-            return lhs.data() == GetEmptyKey().data();
-        if (rhs.data() == GetTombstoneKey().data())
-            return lhs.data() == GetTombstoneKey().data();
+    static bool IsEqual(const std::string &lhs, const std::string &rhs) {
         return lhs == rhs;
     }
+
+    static bool IsEqual(const char *lhs, const std::string &rhs) {
+        return rhs.compare(lhs) == 0;
+    }
+
+    static unsigned GetHashValue(StringLookupKey Val) {
+        return GetHashValue(Val.Data, Val.Length);
+    }
+
+    static bool IsEqual(StringLookupKey lhs, const std::string &rhs) {
+        return rhs.compare(0, std::string::npos, lhs.Data, lhs.Length) == 0;
+    }
+
+#if __cplusplus >= 201703L
+    static unsigned GetHashValue(std::string_view Val) {
+        return GetHashValue(Val.data(), Val.size());
+    }
+
+    static bool IsEqual(std::string_view lhs, const std::string &rhs) {
+        return lhs == rhs;
+    }
+#endif
 };
 
 template <>
@@ -232,3 +346,39 @@ struct HashMapInfo<hash_code> {
     static unsigned GetHashValue(hash_code val) { return val; }
     static bool IsEqual(hash_code lhs, hash_code rhs) { return lhs == rhs; }
 };
+
+/// WideHashMapInfo - HashMapInfo<T> with the full 64-bit hash_value() of
+/// the key. A map keyed by it runs in 64-bit mode: counts are size_t, the
+/// hash is kept whole through probing, and tables may exceed 4G buckets.
+template <typename T>
+struct WideHashMapInfo : HashMapInfo<T> {
+    static uint64_t GetHashValue(const T &Val) { return hash_value(Val); }
+};
+
+// Keep the heterogeneous lookups of HashMapInfo<std::string>, at full width.
+template <>
+struct WideHashMapInfo<std::string> : HashMapInfo<std::string> {
+    static uint64_t GetHashValue(const std::string &Val) {
+        assert(Val != GetEmptyKey() && "Cannot hash the empty key!");
+        assert(Val != GetTombstoneKey() && "Cannot hash the tombstone key!");
+        return GetHashValue(Val.data(), Val.size());
+    }
+
+    static uint64_t GetHashValue(const char *Val) {
+        return GetHashValue(Val, std::strlen(Val));
+    }
+
+    static uint64_t GetHashValue(const char *Data, size_t Length) {
+        return hash_combine_range(Data, Data + Length);
+    }
+
+    static uint64_t GetHashValue(StringLookupKey Val) {
+        return GetHashValue(Val.Data, Val.Length);
+    }
+
+#if __cplusplus >= 201703L
+    static uint64_t GetHashValue(std::string_view Val) {
+        return GetHashValue(Val.data(), Val.size());
+    }
+#endif
+};
@@ -0,0 +1,726 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#ifndef HASHMAP_HAVE_SSE2
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HASHMAP_HAVE_SSE2 1
+#else
+#define HASHMAP_HAVE_SSE2 0
+#endif
+#endif
+
+#if HASHMAP_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "common/compiler.h"
+#include "common/math_utils.h"
+
+namespace detail {
+
+/// BucketHashTraits - Buckets that cache the hash of their key provide
+/// GetHash() and SetHash(). Probing then rejects a bucket whose cached hash
+/// differs before calling KeyInfoT::IsEqual, and Grow() reuses the cached
+/// hash instead of rehashing the key.
+template <typename BucketT, typename = void>
+struct BucketHashTraits {
+    static constexpr bool StoresHash = false;
+    static constexpr size_t StoredHashSize = 0;
+    template <typename KeyInfoT>
+    static auto GetHash(const BucketT &B)
+        -> decltype(KeyInfoT::GetHashValue(B.GetFirst())) {
+        return KeyInfoT::GetHashValue(B.GetFirst());
+    }
+    template <typename HashT>
+    static bool MayMatch(const BucketT &, HashT) { return true; }
+    template <typename HashT>
+    static void SetHash(BucketT &, HashT) {}
+    static void CopyHash(BucketT &, const BucketT &) {}
+    static void SwapHash(BucketT &, BucketT &) {}
+};
+
+template <typename BucketT>
+struct BucketHashTraits<
+    BucketT, decltype(std::declval<BucketT &>().SetHash(0U), void())> {
+    static constexpr bool StoresHash = true;
+    static constexpr size_t StoredHashSize =
+        sizeof(decltype(std::declval<const BucketT &>().GetHash()));
+    template <typename KeyInfoT>
+    static auto GetHash(const BucketT &B)
+        -> decltype(KeyInfoT::GetHashValue(B.GetFirst())) {
+        return static_cast<decltype(KeyInfoT::GetHashValue(B.GetFirst()))>(
+            B.GetHash());
+    }
+    template <typename HashT>
+    static bool MayMatch(const BucketT &B, HashT Hash) {
+        return B.GetHash() == Hash;
+    }
+    template <typename HashT>
+    static void SetHash(BucketT &B, HashT Hash) { B.SetHash(Hash); }
+    static void CopyHash(BucketT &Dst, const BucketT &Src) {
+        Dst.SetHash(Src.GetHash());
+    }
+    static void SwapHash(BucketT &LHS, BucketT &RHS) {
+        auto Tmp = LHS.GetHash();
+        LHS.SetHash(RHS.GetHash());
+        RHS.SetHash(Tmp);
+    }
+};
+
+/// getHomeBucket - The first bucket of the probe sequence for \p Hash in a
+/// table of \p NumBuckets buckets, a power of two. A 32-bit hash gives its
+/// low bits. A 64-bit hash, from a KeyInfoT such as WideHashMapInfo, gives
+/// its high bits: those are the best mixed bits of a multiplicative hash,
+/// and they leave the low bits to the hash tag of SwissGroupProbing.
+template <typename HashT>
+inline size_t getHomeBucket(HashT Hash, size_t NumBuckets) {
+    static_assert(sizeof(HashT) == 4 || sizeof(HashT) == 8,
+                  "Hashes are 32 or 64 bits wide!");
+    if (sizeof(HashT) == 4) return Hash & (NumBuckets - 1);
+    // Shift in two steps, so a table of one bucket doesn't shift by 64.
+    return static_cast<size_t>((static_cast<uint64_t>(Hash) >> 1) >>
+                               (63 - countTrailingZeros(
+                                         static_cast<uint64_t>(NumBuckets))));
+}
+
+}  // end namespace detail
+
+// Probing policies decide where HashMapBase looks for a key. The keys in the
+// bucket array remain the source of truth for occupancy: empty and tombstone
+// keys are written exactly as before, so iteration, copying and destruction
+// work the same under every policy. A policy may additionally keep
+// getMetadataSize(NumBuckets) bytes of per-bucket metadata, which the map
+// allocates directly after its bucket array.
+//
+// A policy with MovesEntries set keeps its probe sequences ordered, and has
+// the map move entries around instead of leaving tombstones: on a miss,
+// LookupBucketFor() may return a full bucket, which the map empties with
+// shiftForward() before inserting there, and erase() closes the gap it
+// leaves with shiftBackward().
+//
+// Bucket numbers and counts are size_t, and hashes either unsigned or
+// uint64_t, as HashMapBase picks from its KeyInfoT; the home bucket of a
+// hash is always detail::getHomeBucket().
+//
+// BucketsPerProbe is how many buckets a policy looks at in one step, which
+// HashMapStats counts probe lengths in.
+//
+// A policy with HasOccupancyBitmap set starts its metadata with the
+// detail::OccupancyBits of the table, which HashMapIterator, clear() and the
+// destructor use to skip the buckets that hold no entry.
+
+/// QuadraticProbing - Probe one bucket at a time with quadratic probing,
+/// comparing each bucket key against the empty and tombstone keys. This is
+/// the default policy and keeps no metadata.
+struct QuadraticProbing {
+    static constexpr bool UsesMetadata = false;
+    static constexpr bool MovesEntries = false;
+    static constexpr bool HasOccupancyBitmap = false;
+    static constexpr unsigned BucketsPerProbe = 1;
+
+    static constexpr size_t getMetadataSize(size_t) { return 0; }
+    static void initMetadata(uint8_t *, size_t) {}
+    template <typename HashT>
+    static void setFull(uint8_t *, size_t, size_t, HashT) {}
+    static void setDeleted(uint8_t *, size_t, size_t) {}
+
+    /// Prefetch - Start loading the first bucket LookupBucketFor will probe.
+    template <typename BucketT, typename HashT>
+    static void Prefetch(const BucketT *Bucketsptr, const uint8_t *,
+                         size_t num_buckets_, HashT Hash) {
+        BUILTIN_PREFETCH(Bucketsptr +
+                         detail::getHomeBucket(Hash, num_buckets_));
+    }
+
+    /// LookupBucketFor - Lookup the appropriate bucket for Val, returning it
+    /// in FoundBucket.  If the bucket contains the key and a value, this
+    /// returns true, otherwise it returns a bucket with an empty marker or
+    /// tombstone and returns false.
+    template <typename KeyInfoT, typename BucketT, typename LookupKeyT,
+              typename HashT>
+    static bool LookupBucketFor(const BucketT *Bucketsptr, const uint8_t *,
+                                size_t num_buckets_, const LookupKeyT &Val,
+                                HashT Hash, const BucketT *&FoundBucket) {
+        // FoundTombstone - Keep track of whether we find a tombstone while
+        // probing.
+        const BucketT *FoundTombstone = nullptr;
+        const auto EmptyKey = KeyInfoT::GetEmptyKey();
+        const auto TombstoneKey = KeyInfoT::GetTombstoneKey();
+
+        size_t BucketNo = detail::getHomeBucket(Hash, num_buckets_);
+        size_t ProbeAmt = 1;
+        while (true) {
+            const BucketT *ThisBucket = Bucketsptr + BucketNo;
+            // Found Val's bucket?  If so, return it.
+            if (detail::BucketHashTraits<BucketT>::MayMatch(*ThisBucket,
+                                                            Hash) &&
+                KeyInfoT::IsEqual(Val, ThisBucket->GetFirst())) {
+                FoundBucket = ThisBucket;
+                return true;
+            }
+
+            // If we found an empty bucket, the key doesn't exist in the set.
+            // Insert it and return the default value.
+            if (KeyInfoT::IsEqual(ThisBucket->GetFirst(), EmptyKey)) {
+                // If we've already seen a tombstone while probing, fill it in
+                // instead of the empty bucket we eventually probed to.
+                FoundBucket = FoundTombstone ? FoundTombstone : ThisBucket;
+                return false;
+            }
+
+            // If this is a tombstone, remember it.  If Val ends up not in the
+            // map, we prefer to return it than something that would require
+            // more probing.
+            if (KeyInfoT::IsEqual(ThisBucket->GetFirst(), TombstoneKey) &&
+                !FoundTombstone)
+                FoundTombstone =
+                    ThisBucket;  // Remember the first tombstone found.
+
+            // Otherwise, it's a hash collision or a tombstone, continue
+            // quadratic probing.
+            BucketNo += ProbeAmt++;
+            BucketNo &= (num_buckets_ - 1);
+        }
+    }
+
+    /// FindEmptyBucket - Return the first empty bucket on the probe sequence
+    /// for Hash. Only valid on a table without tombstones that is known not
+    /// to contain the key, which is what Grow() rebuilds into.
+    template <typename KeyInfoT, typename BucketT, typename HashT>
+    static BucketT *FindEmptyBucket(BucketT *Bucketsptr, const uint8_t *,
+                                    size_t num_buckets_, HashT Hash) {
+        const auto EmptyKey = KeyInfoT::GetEmptyKey();
+        size_t BucketNo = detail::getHomeBucket(Hash, num_buckets_);
+        size_t ProbeAmt = 1;
+        while (!KeyInfoT::IsEqual(Bucketsptr[BucketNo].GetFirst(), EmptyKey)) {
+            BucketNo += ProbeAmt++;
+            BucketNo &= (num_buckets_ - 1);
+        }
+        return Bucketsptr + BucketNo;
+    }
+
+    /// FindBucketIf - Return the index of the first bucket on the probe
+    /// sequence for Hash that satisfies Pred. Used to rehash in place, where
+    /// the keys and metadata are mid-update and can't be probed directly.
+    template <typename HashT, typename PredT>
+    static size_t FindBucketIf(size_t num_buckets_, HashT Hash, PredT Pred) {
+        size_t BucketNo = detail::getHomeBucket(Hash, num_buckets_);
+        size_t ProbeAmt = 1;
+        while (!Pred(BucketNo)) {
+            BucketNo += ProbeAmt++;
+            BucketNo &= (num_buckets_ - 1);
+        }
+        return BucketNo;
+    }
+};
+
+namespace detail {
+
+/// Control byte values for SwissGroupProbing. A full bucket stores the low 7
+/// bits of its hash, so only empty and deleted buckets have the high bit set.
+enum : uint8_t { CtrlEmpty = 0x80, CtrlDeleted = 0xFE };
+
+/// SwissGroup - A window of 16 consecutive control bytes. Each Match* method
+/// returns a bitmask with bit I set when byte I of the window matches.
+#if HASHMAP_HAVE_SSE2
+class SwissGroup {
+    __m128i Ctrl;
+
+    uint32_t MatchByte(uint8_t Byte) const {
+        __m128i Needle = _mm_set1_epi8(static_cast<char>(Byte));
+        return static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(Needle, Ctrl)));
+    }
+
+public:
+    static constexpr unsigned Width = 16;
+
+    explicit SwissGroup(const uint8_t *Pos)
+        : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Pos))) {}
+
+    uint32_t Match(uint8_t H2) const { return MatchByte(H2); }
+    uint32_t MatchEmpty() const { return MatchByte(CtrlEmpty); }
+    uint32_t MatchDeleted() const { return MatchByte(CtrlDeleted); }
+};
+#else
+class SwissGroup {
+    const uint8_t *Ctrl;
+
+    uint32_t MatchByte(uint8_t Byte) const {
+        uint32_t Mask = 0;
+        for (unsigned i = 0; i != Width; ++i)
+            if (Ctrl[i] == Byte) Mask |= 1U << i;
+        return Mask;
+    }
+
+public:
+    static constexpr unsigned Width = 16;
+
+    explicit SwissGroup(const uint8_t *Pos) : Ctrl(Pos) {}
+
+    uint32_t Match(uint8_t H2) const { return MatchByte(H2); }
+    uint32_t MatchEmpty() const { return MatchByte(CtrlEmpty); }
+    uint32_t MatchDeleted() const { return MatchByte(CtrlDeleted); }
+};
+#endif
+
+}  // end namespace detail
+
+/// SwissGroupProbing - Keep one control byte per bucket (7 hash bits, or an
+/// empty/deleted state) and probe a whole group of 16 buckets per step. The
+/// full key is only compared when the 7 hash bits match, and empty or
+/// tombstone buckets are recognized from their control byte alone.
+///
+/// The control array holds NumBuckets bytes plus a copy of the first
+/// GroupWidth bytes at the end, so a group starting near the end of the array
+/// can be loaded without wrapping. Tables smaller than a group repeat their
+/// bytes to fill that tail.
+struct SwissGroupProbing {
+    static constexpr bool UsesMetadata = true;
+    static constexpr bool MovesEntries = false;
+    static constexpr bool HasOccupancyBitmap = false;
+    static constexpr unsigned GroupWidth = detail::SwissGroup::Width;
+    static constexpr unsigned BucketsPerProbe = GroupWidth;
+
+    static constexpr size_t getMetadataSize(size_t NumBuckets) {
+        return NumBuckets ? NumBuckets + GroupWidth : 0;
+    }
+
+    static void initMetadata(uint8_t *Ctrl, size_t NumBuckets) {
+        if (NumBuckets)
+            std::memset(Ctrl, detail::CtrlEmpty, getMetadataSize(NumBuckets));
+    }
+
+    template <typename HashT>
+    static void setFull(uint8_t *Ctrl, size_t NumBuckets, size_t BucketNo,
+                        HashT Hash) {
+        setCtrl(Ctrl, NumBuckets, BucketNo, H2(Hash));
+    }
+
+    static void setDeleted(uint8_t *Ctrl, size_t NumBuckets, size_t BucketNo) {
+        setCtrl(Ctrl, NumBuckets, BucketNo, detail::CtrlDeleted);
+    }
+
+    /// Prefetch - Start loading the first group of control bytes and the
+    /// bucket it most likely points at.
+    template <typename BucketT, typename HashT>
+    static void Prefetch(const BucketT *Buckets, const uint8_t *Ctrl,
+                         size_t NumBuckets, HashT Hash) {
+        const size_t Pos = detail::getHomeBucket(H1(Hash), NumBuckets);
+        BUILTIN_PREFETCH(Ctrl + Pos);
+        BUILTIN_PREFETCH(Buckets + Pos);
+    }
+
+    template <typename KeyInfoT, typename BucketT, typename LookupKeyT,
+              typename HashT>
+    static bool LookupBucketFor(const BucketT *Buckets, const uint8_t *Ctrl,
+                                size_t NumBuckets, const LookupKeyT &Val,
+                                HashT Hash, const BucketT *&FoundBucket) {
+        const size_t Mask = NumBuckets - 1;
+        const uint8_t Tag = H2(Hash);
+        const BucketT *FoundTombstone = nullptr;
+
+        size_t Pos = detail::getHomeBucket(H1(Hash), NumBuckets);
+        size_t Stride = 0;
+        while (true) {
+            detail::SwissGroup Group(Ctrl + Pos);
+            for (uint32_t Bits = Group.Match(Tag); Bits; Bits &= Bits - 1) {
+                const BucketT *ThisBucket =
+                    Buckets + ((Pos + countTrailingZeros(Bits)) & Mask);
+                if (detail::BucketHashTraits<BucketT>::MayMatch(*ThisBucket,
+                                                                Hash) &&
+                    KeyInfoT::IsEqual(Val, ThisBucket->GetFirst())) {
+                    FoundBucket = ThisBucket;
+                    return true;
+                }
+            }
+
+            // Remember the first tombstone, as QuadraticProbing does, so an
+            // insertion reuses it instead of taking a fresh empty bucket.
+            if (!FoundTombstone)
+                if (uint32_t Bits = Group.MatchDeleted())
+                    FoundTombstone =
+                        Buckets + ((Pos + countTrailingZeros(Bits)) & Mask);
+
+            if (uint32_t Bits = Group.MatchEmpty()) {
+                FoundBucket =
+                    FoundTombstone
+                        ? FoundTombstone
+                        : Buckets + ((Pos + countTrailingZeros(Bits)) & Mask);
+                return false;
+            }
+
+            // Triangular probing over groups visits every group of a
+            // power-of-two table.
+            Stride += GroupWidth;
+            Pos = (Pos + Stride) & Mask;
+        }
+    }
+
+    template <typename KeyInfoT, typename BucketT, typename HashT>
+    static BucketT *FindEmptyBucket(BucketT *Buckets, const uint8_t *Ctrl,
+                                    size_t NumBuckets, HashT Hash) {
+        const size_t Mask = NumBuckets - 1;
+        size_t Pos = detail::getHomeBucket(H1(Hash), NumBuckets);
+        size_t Stride = 0;
+        while (true) {
+            if (uint32_t Bits = detail::SwissGroup(Ctrl + Pos).MatchEmpty())
+                return Buckets + ((Pos + countTrailingZeros(Bits)) & Mask);
+            Stride += GroupWidth;
+            Pos = (Pos + Stride) & Mask;
+        }
+    }
+
+    /// FindBucketIf - Return the index of the first bucket on the probe
+    /// sequence for Hash that satisfies Pred, testing the buckets of each
+    /// group in the order a group match visits them.
+    template <typename HashT, typename PredT>
+    static size_t FindBucketIf(size_t NumBuckets, HashT Hash, PredT Pred) {
+        const size_t Mask = NumBuckets - 1;
+        size_t Pos = detail::getHomeBucket(H1(Hash), NumBuckets);
+        size_t Stride = 0;
+        while (true) {
+            for (unsigned i = 0; i != GroupWidth; ++i)
+                if (Pred((Pos + i) & Mask)) return (Pos + i) & Mask;
+            Stride += GroupWidth;
+            Pos = (Pos + Stride) & Mask;
+        }
+    }
+
+private:
+    /// H1 - The hash bits that pick the first group. A 32-bit hash rotates
+    /// its tag bits out of the way of the mask; a 64-bit one is indexed by
+    /// its high bits, which never overlap the tag.
+    static unsigned H1(unsigned Hash) { return (Hash >> 7) | (Hash << 25); }
+    static uint64_t H1(uint64_t Hash) { return Hash; }
+    template <typename HashT>
+    static uint8_t H2(HashT Hash) { return Hash & 0x7F; }
+
+    static void setCtrl(uint8_t *Ctrl, size_t NumBuckets, size_t BucketNo,
+                        uint8_t Byte) {
+        assert(BucketNo < NumBuckets && "Bucket out of range!");
+        Ctrl[BucketNo] = Byte;
+        // Mirror the byte into the cloned tail.
+        for (size_t i = BucketNo + NumBuckets; i < NumBuckets + GroupWidth;
+             i += NumBuckets)
+            Ctrl[i] = Byte;
+    }
+};
+
+/// RobinHoodProbing - Linear probing that keeps every probe sequence ordered
+/// by distance from the home bucket: an insertion takes the bucket of the
+/// first entry that sits closer to its own home than the new key would,
+/// shifting the rest of the cluster one bucket forward. A lookup can then
+/// stop at the first entry closer to home than the probe, and erase() moves
+/// the entries after the erased one back instead of leaving a tombstone, so
+/// delete-heavy tables keep short and even probe sequences.
+///
+/// The metadata is one byte per bucket: 0 for an empty bucket, otherwise
+/// the distance of its entry plus one, saturated at SaturatedDistance. Only
+/// entries that far from home need their key hashed to learn the actual
+/// distance. A full bucket at the expected distance is all a probe compares
+/// keys for, as with the hash bits of SwissGroupProbing.
+///
+/// erase() may move the next entry into the erased bucket, so iterators
+/// aren't stable across erase(), not even the one passed to it.
+struct RobinHoodProbing {
+    static constexpr bool UsesMetadata = true;
+    static constexpr bool MovesEntries = true;
+    static constexpr bool HasOccupancyBitmap = false;
+    static constexpr unsigned BucketsPerProbe = 1;
+    static constexpr uint8_t SaturatedDistance = 0xFF;
+
+    static constexpr size_t getMetadataSize(size_t NumBuckets) {
+        return NumBuckets;
+    }
+
+    static void initMetadata(uint8_t *Dist, size_t NumBuckets) {
+        if (NumBuckets) std::memset(Dist, 0, NumBuckets);
+    }
+
+    template <typename HashT>
+    static void setFull(uint8_t *Dist, size_t NumBuckets, size_t BucketNo,
+                        HashT Hash) {
+        Dist[BucketNo] =
+            encode((BucketNo - detail::getHomeBucket(Hash, NumBuckets)) &
+                   (NumBuckets - 1));
+    }
+
+    static void setDeleted(uint8_t *Dist, size_t, size_t BucketNo) {
+        Dist[BucketNo] = 0;
+    }
+
+    template <typename BucketT, typename HashT>
+    static void Prefetch(const BucketT *Buckets, const uint8_t *Dist,
+                         size_t NumBuckets, HashT Hash) {
+        const size_t Pos = detail::getHomeBucket(Hash, NumBuckets);
+        BUILTIN_PREFETCH(Dist + Pos);
+        BUILTIN_PREFETCH(Buckets + Pos);
+    }
+
+    /// LookupBucketFor - On a miss, FoundBucket is where Val belongs: an
+    /// empty bucket, or the first entry closer to its home than Val.
+    template <typename KeyInfoT, typename BucketT, typename LookupKeyT,
+              typename HashT>
+    static bool LookupBucketFor(const BucketT *Buckets, const uint8_t *Dist,
+                                size_t NumBuckets, const LookupKeyT &Val,
+                                HashT Hash, const BucketT *&FoundBucket) {
+        const size_t Mask = NumBuckets - 1;
+        size_t Pos = detail::getHomeBucket(Hash, NumBuckets);
+        for (size_t D = 0;; ++D, Pos = (Pos + 1) & Mask) {
+            const uint8_t Stored = Dist[Pos];
+            const BucketT *ThisBucket = Buckets + Pos;
+            if (Stored == encode(D)) {
+                if (detail::BucketHashTraits<BucketT>::MayMatch(*ThisBucket,
+                                                                Hash) &&
+                    KeyInfoT::IsEqual(Val, ThisBucket->GetFirst())) {
+                    FoundBucket = ThisBucket;
+                    return true;
+                }
+                if (Stored != SaturatedDistance ||
+                    getDistance<KeyInfoT>(Buckets, Dist, NumBuckets, Pos) >= D)
+                    continue;
+            } else if (Stored > encode(D)) {
+                continue;
+            }
+            FoundBucket = ThisBucket;
+            return false;
+        }
+    }
+
+    /// FindEmptyBucket - Return the bucket a key with this Hash is inserted
+    /// at, on a table known not to contain it. It may be full, see
+    /// shiftForward().
+    template <typename KeyInfoT, typename BucketT, typename HashT>
+    static BucketT *FindEmptyBucket(BucketT *Buckets, const uint8_t *Dist,
+                                    size_t NumBuckets, HashT Hash) {
+        const size_t Mask = NumBuckets - 1;
+        size_t Pos = detail::getHomeBucket(Hash, NumBuckets);
+        for (size_t D = 0;; ++D, Pos = (Pos + 1) & Mask) {
+            const uint8_t Stored = Dist[Pos];
+            if (Stored < encode(D)) return Buckets + Pos;  // Empty too.
+            if (Stored == SaturatedDistance && encode(D) == SaturatedDistance &&
+                getDistance<KeyInfoT>(Buckets, Dist, NumBuckets, Pos) < D)
+                return Buckets + Pos;
+        }
+    }
+
+    template <typename HashT, typename PredT>
+    static size_t FindBucketIf(size_t NumBuckets, HashT Hash, PredT Pred) {
+        size_t BucketNo = detail::getHomeBucket(Hash, NumBuckets);
+        while (!Pred(BucketNo)) BucketNo = (BucketNo + 1) & (NumBuckets - 1);
+        return BucketNo;
+    }
+
+    /// getDistance - Return how far the entry in the full bucket BucketNo
+    /// is from its home bucket.
+    template <typename KeyInfoT, typename BucketT>
+    static size_t getDistance(const BucketT *Buckets, const uint8_t *Dist,
+                              size_t NumBuckets, size_t BucketNo) {
+        assert(Dist[BucketNo] != 0 && "Empty bucket has no distance!");
+        if (Dist[BucketNo] != SaturatedDistance) return Dist[BucketNo] - 1;
+        const size_t Home = detail::getHomeBucket(
+            detail::BucketHashTraits<BucketT>::template GetHash<KeyInfoT>(
+                Buckets[BucketNo]),
+            NumBuckets);
+        return (BucketNo - Home) & (NumBuckets - 1);
+    }
+
+    /// shiftForward - Empty the full bucket BucketNo for an insertion by
+    /// moving it and the entries after it in its cluster one bucket
+    /// forward. Move(To, From) moves an entry into an empty bucket and
+    /// leaves From empty; the table must have an empty bucket.
+    template <typename MoveT>
+    static void shiftForward(uint8_t *Dist, size_t NumBuckets, size_t BucketNo,
+                             MoveT Move) {
+        const size_t Mask = NumBuckets - 1;
+        size_t Last = BucketNo;
+        while (Dist[Last] != 0) Last = (Last + 1) & Mask;
+        while (Last != BucketNo) {
+            const size_t Prev = (Last - 1) & Mask;
+            Move(Last, Prev);
+            Dist[Last] = Dist[Prev] == SaturatedDistance ? SaturatedDistance
+                                                         : Dist[Prev] + 1;
+            Last = Prev;
+        }
+        Dist[BucketNo] = 0;
+    }
+
+    /// shiftBackward - Fill the bucket BucketNo, just emptied by erase(), by
+    /// moving the entries after it one bucket back, up to the first entry
+    /// that is already in its home bucket. Move is as for shiftForward().
+    template <typename KeyInfoT, typename BucketT, typename MoveT>
+    static void shiftBackward(const BucketT *Buckets, uint8_t *Dist,
+                              size_t NumBuckets, size_t BucketNo, MoveT Move) {
+        const size_t Mask = NumBuckets - 1;
+        size_t Hole = BucketNo;
+        for (size_t Next = (Hole + 1) & Mask; Dist[Next] > 1;
+             Hole = Next, Next = (Next + 1) & Mask) {
+            Dist[Hole] =
+                Dist[Next] == SaturatedDistance
+                    ? encode(getDistance<KeyInfoT>(Buckets, Dist, NumBuckets,
+                                                   Next) -
+                             1)
+                    : Dist[Next] - 1;
+            Move(Hole, Next);
+        }
+        Dist[Hole] = 0;
+    }
+
+private:
+    static uint8_t encode(size_t Distance) {
+        return Distance < SaturatedDistance - 1 ? Distance + 1
+                                                : SaturatedDistance;
+    }
+};
+
+namespace detail {
+
+/// OccupancyBits - A bitmap with one bit per bucket, set while the bucket
+/// holds an entry. A bucket is addressed by its distance D = NumBuckets - i
+/// from the end of the bucket array, which is where the metadata starts, so
+/// that an iterator can find the bit of the bucket it points at from the end
+/// pointer alone: word (D - 1) / 64 holds it, at bit -D mod 64. Walking the
+/// buckets forward walks the words backward, each from its low bit up.
+struct OccupancyBits {
+    static constexpr size_t getSize(size_t NumBuckets) {
+        return (NumBuckets + 63) / 64 * sizeof(uint64_t);
+    }
+
+    static void set(uint8_t *Bits, size_t NumBuckets, size_t BucketNo) {
+        const size_t D = NumBuckets - BucketNo;
+        storeWord(Bits, (D - 1) / 64,
+                  loadWord(Bits, (D - 1) / 64) | getMask(D));
+    }
+
+    static void reset(uint8_t *Bits, size_t NumBuckets, size_t BucketNo) {
+        const size_t D = NumBuckets - BucketNo;
+        storeWord(Bits, (D - 1) / 64,
+                  loadWord(Bits, (D - 1) / 64) & ~getMask(D));
+    }
+
+    /// findNext - Return the distance from the end of the first occupied
+    /// bucket at or after the one at distance \p D, or 0 if there is none.
+    static size_t findNext(const uint8_t *Bits, size_t D) {
+        size_t W = (D - 1) / 64;
+        uint64_t Word = loadWord(Bits, W) & (~uint64_t(0) << ((0 - D) & 63));
+        while (Word == 0) {
+            if (W == 0) return 0;
+            Word = loadWord(Bits, --W);
+        }
+        return W * 64 + 64 - countTrailingZeros(Word);
+    }
+
+    /// forEach - Call Fn(BucketNo) for every occupied bucket, in order.
+    template <typename FnT>
+    static void forEach(const uint8_t *Bits, size_t NumBuckets, FnT Fn) {
+        if (NumBuckets == 0) return;
+        for (size_t D = findNext(Bits, NumBuckets); D != 0;
+             D = D > 1 ? findNext(Bits, D - 1) : 0)
+            Fn(NumBuckets - D);
+    }
+
+private:
+    static uint64_t getMask(size_t D) { return uint64_t(1) << ((0 - D) & 63); }
+
+    // The bitmap follows the bucket array, so it may not be 8-byte aligned.
+    static uint64_t loadWord(const uint8_t *Bits, size_t W) {
+        uint64_t Word;
+        std::memcpy(&Word, Bits + W * sizeof(uint64_t), sizeof(Word));
+        return Word;
+    }
+
+    static void storeWord(uint8_t *Bits, size_t W, uint64_t Word) {
+        std::memcpy(Bits + W * sizeof(uint64_t), &Word, sizeof(Word));
+    }
+};
+
+}  // end namespace detail
+
+/// OccupancyBitmap - Probe as ProbeT does, and also keep a bitmap of the
+/// buckets that hold an entry, in front of ProbeT's metadata. Iterating,
+/// clearing and destroying the map then go from one entry to the next with
+/// a count of trailing zeros, instead of comparing every bucket key against
+/// the empty and tombstone keys, which pays off in tables left sparse by
+/// erasing. Inserting and erasing cost one more read-modify-write of a word.
+///
+/// Policies that move entries are not supported: each move would have to
+/// move its bit too.
+template <typename ProbeT = QuadraticProbing>
+struct OccupancyBitmap {
+    static_assert(!ProbeT::MovesEntries,
+                  "OccupancyBitmap needs a policy that leaves tombstones!");
+
+    static constexpr bool UsesMetadata = true;
+    static constexpr bool MovesEntries = false;
+    static constexpr bool HasOccupancyBitmap = true;
+    static constexpr unsigned BucketsPerProbe = ProbeT::BucketsPerProbe;
+
+    static constexpr size_t getMetadataSize(size_t NumBuckets) {
+        return NumBuckets ? detail::OccupancyBits::getSize(NumBuckets) +
+                                ProbeT::getMetadataSize(NumBuckets)
+                          : 0;
+    }
+
+    static void initMetadata(uint8_t *Meta, size_t NumBuckets) {
+        if (NumBuckets == 0) return;
+        std::memset(Meta, 0, detail::OccupancyBits::getSize(NumBuckets));
+        ProbeT::initMetadata(getInner(Meta, NumBuckets), NumBuckets);
+    }
+
+    template <typename HashT>
+    static void setFull(uint8_t *Meta, size_t NumBuckets, size_t BucketNo,
+                        HashT Hash) {
+        detail::OccupancyBits::set(Meta, NumBuckets, BucketNo);
+        ProbeT::setFull(getInner(Meta, NumBuckets), NumBuckets, BucketNo,
+                        Hash);
+    }
+
+    static void setDeleted(uint8_t *Meta, size_t NumBuckets, size_t BucketNo) {
+        detail::OccupancyBits::reset(Meta, NumBuckets, BucketNo);
+        ProbeT::setDeleted(getInner(Meta, NumBuckets), NumBuckets, BucketNo);
+    }
+
+    template <typename BucketT, typename HashT>
+    static void Prefetch(const BucketT *Buckets, const uint8_t *Meta,
+                         size_t NumBuckets, HashT Hash) {
+        ProbeT::Prefetch(Buckets, getInner(Meta, NumBuckets), NumBuckets,
+                         Hash);
+    }
+
+    template <typename KeyInfoT, typename BucketT, typename LookupKeyT,
+              typename HashT>
+    static bool LookupBucketFor(const BucketT *Buckets, const uint8_t *Meta,
+                                size_t NumBuckets, const LookupKeyT &Val,
+                                HashT Hash, const BucketT *&FoundBucket) {
+        return ProbeT::template LookupBucketFor<KeyInfoT>(
+            Buckets, getInner(Meta, NumBuckets), NumBuckets, Val, Hash,
+            FoundBucket);
+    }
+
+    template <typename KeyInfoT, typename BucketT, typename HashT>
+    static BucketT *FindEmptyBucket(BucketT *Buckets, const uint8_t *Meta,
+                                    size_t NumBuckets, HashT Hash) {
+        return ProbeT::template FindEmptyBucket<KeyInfoT>(
+            Buckets, getInner(Meta, NumBuckets), NumBuckets, Hash);
+    }
+
+    template <typename HashT, typename PredT>
+    static size_t FindBucketIf(size_t NumBuckets, HashT Hash, PredT Pred) {
+        return ProbeT::FindBucketIf(NumBuckets, Hash, Pred);
+    }
+
+private:
+    static uint8_t *getInner(uint8_t *Meta, size_t NumBuckets) {
+        return Meta + detail::OccupancyBits::getSize(NumBuckets);
+    }
+    static const uint8_t *getInner(const uint8_t *Meta, size_t NumBuckets) {
+        return Meta + detail::OccupancyBits::getSize(NumBuckets);
+    }
+};
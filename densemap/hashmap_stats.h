@@ -0,0 +1,180 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+
+#include "common/compiler.h"
+
+/// HASHMAP_ENABLE_STATS - Define to 1 to have every HashMapBase count its
+/// lookups and their probe lengths, and time its grows and rehashes, for
+/// getStats(). Off by default, leaving no trace in the maps. When on, each
+/// lookup walks its probe sequence a second time to measure it, and the
+/// counters are updated atomically so that concurrent readers stay safe.
+#ifndef HASHMAP_ENABLE_STATS
+#define HASHMAP_ENABLE_STATS 0
+#endif
+
+#if HASHMAP_ENABLE_STATS
+#include <atomic>
+#include <chrono>
+#endif
+
+/// HashMapStats - A snapshot of the health of a map, from
+/// HashMapBase::getStats(). The occupancy is always filled in; the lookup,
+/// grow and rehash counters only when built with HASHMAP_ENABLE_STATS.
+///
+/// A lookup's probe length is the number of probes, of the policy's
+/// BucketsPerProbe buckets each, that reach the bucket holding the key or
+/// the first empty one. Policies whose metadata can stop a miss earlier, as
+/// RobinHoodProbing's does, take at most that many.
+struct HashMapStats {
+    /// Lookups by probe length: 1, 2, 3, 4, 5-8, 9-16, 17-32 and 33+.
+    static constexpr unsigned NumProbeBins = 8;
+
+    bool Enabled = HASHMAP_ENABLE_STATS;
+    uint64_t NumBuckets = 0;
+    uint64_t NumEntries = 0;
+    uint64_t NumTombstones = 0;
+
+    uint64_t NumLookups = 0;
+    uint64_t NumProbes = 0;  // Summed over all lookups.
+    uint64_t ProbeHistogram[NumProbeBins] = {};
+    uint64_t NumGrows = 0;
+    uint64_t GrowNanos = 0;
+    uint64_t NumRehashes = 0;  // Same-size rehashes that drop tombstones.
+    uint64_t RehashNanos = 0;
+
+    static unsigned getProbeBin(uint64_t Probes) {
+        if (Probes <= 4) return Probes ? unsigned(Probes) - 1 : 0;
+        unsigned Bin = 4;
+        for (uint64_t Limit = 8; Probes > Limit && Bin + 1 != NumProbeBins;
+             Limit *= 2)
+            ++Bin;
+        return Bin;
+    }
+
+    static const char *getProbeBinName(unsigned Bin) {
+        static const char *Names[NumProbeBins] = {
+            "1", "2", "3", "4", "5-8", "9-16", "17-32", "33+"};
+        return Names[Bin];
+    }
+
+    double getLoadFactor() const {
+        return NumBuckets ? double(NumEntries) / NumBuckets : 0;
+    }
+
+    double getTombstoneRatio() const {
+        return NumBuckets ? double(NumTombstones) / NumBuckets : 0;
+    }
+
+    double getMeanProbes() const {
+        return NumLookups ? double(NumProbes) / NumLookups : 0;
+    }
+
+    void print(std::FILE *OS) const {
+        std::fprintf(OS,
+                     "%llu buckets, %llu entries, %llu tombstones "
+                     "(load %.3f, tombstones %.3f)\n",
+                     (unsigned long long)NumBuckets,
+                     (unsigned long long)NumEntries,
+                     (unsigned long long)NumTombstones, getLoadFactor(),
+                     getTombstoneRatio());
+        if (!Enabled) {
+            std::fprintf(OS, "  (build with HASHMAP_ENABLE_STATS for "
+                             "probe lengths, grows and rehashes)\n");
+            return;
+        }
+        std::fprintf(OS, "  %llu lookups, mean probe length %.2f\n ",
+                     (unsigned long long)NumLookups, getMeanProbes());
+        for (unsigned Bin = 0; Bin != NumProbeBins; ++Bin)
+            std::fprintf(OS, " %s:%.1f%%", getProbeBinName(Bin),
+                         NumLookups ? 100.0 * ProbeHistogram[Bin] / NumLookups
+                                    : 0.0);
+        std::fprintf(OS,
+                     "\n  %llu grows in %.3fms, %llu rehashes in %.3fms\n",
+                     (unsigned long long)NumGrows, GrowNanos / 1e6,
+                     (unsigned long long)NumRehashes, RehashNanos / 1e6);
+    }
+
+    DUMP_METHOD void dump() const { print(stderr); }
+};
+
+#if HASHMAP_ENABLE_STATS
+namespace detail {
+
+/// HashMapStatsCounters - The counters behind HashMapStats, kept by every
+/// map. A copied or assigned map starts counting afresh.
+class HashMapStatsCounters {
+    using Counter = std::atomic<uint64_t>;
+
+    Counter NumLookups, NumProbes, ProbeHistogram[HashMapStats::NumProbeBins];
+    Counter NumGrows, GrowNanos, NumRehashes, RehashNanos;
+
+    static void add(Counter &C, uint64_t N) {
+        C.fetch_add(N, std::memory_order_relaxed);
+    }
+
+    static uint64_t get(const Counter &C) {
+        return C.load(std::memory_order_relaxed);
+    }
+
+public:
+    enum class Event { Grow, Rehash };
+
+    /// Timer - Counts one \p E, and the time from its construction to its
+    /// destruction, in \p Stats.
+    class Timer {
+        Counter &Count, &Nanos;
+        std::chrono::steady_clock::time_point Start;
+
+    public:
+        Timer(HashMapStatsCounters &Stats, Event E)
+            : Count(E == Event::Grow ? Stats.NumGrows : Stats.NumRehashes),
+              Nanos(E == Event::Grow ? Stats.GrowNanos : Stats.RehashNanos),
+              Start(std::chrono::steady_clock::now()) {}
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+        ~Timer() {
+            add(Count, 1);
+            add(Nanos, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - Start)
+                           .count());
+        }
+    };
+
+    HashMapStatsCounters() { reset(); }
+    HashMapStatsCounters(const HashMapStatsCounters &) { reset(); }
+    HashMapStatsCounters &operator=(const HashMapStatsCounters &) {
+        reset();
+        return *this;
+    }
+
+    void reset() {
+        NumLookups = 0;
+        NumProbes = 0;
+        for (Counter &C : ProbeHistogram) C = 0;
+        NumGrows = 0;
+        GrowNanos = 0;
+        NumRehashes = 0;
+        RehashNanos = 0;
+    }
+
+    void recordLookup(uint64_t Probes) {
+        add(NumLookups, 1);
+        add(NumProbes, Probes);
+        add(ProbeHistogram[HashMapStats::getProbeBin(Probes)], 1);
+    }
+
+    void copyTo(HashMapStats &S) const {
+        S.NumLookups = get(NumLookups);
+        S.NumProbes = get(NumProbes);
+        for (unsigned Bin = 0; Bin != HashMapStats::NumProbeBins; ++Bin)
+            S.ProbeHistogram[Bin] = get(ProbeHistogram[Bin]);
+        S.NumGrows = get(NumGrows);
+        S.GrowNanos = get(GrowNanos);
+        S.NumRehashes = get(NumRehashes);
+        S.RehashNanos = get(RehashNanos);
+    }
+};
+
+}  // end namespace detail
+#endif
@@ -0,0 +1,276 @@
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include "densemap/hashmap.h"
+
+namespace detail {
+
+/// HashSetEmpty - The value type of the map underneath a HashSet.
+struct HashSetEmpty {};
+
+/// HashSetPair - The bucket of HashSet and SmallHashSet. It holds only the
+/// key; GetSecond() returns the empty base, so HashMapBase can construct and
+/// destroy a "value" that takes no space.
+template <typename KeyT>
+class HashSetPair : public HashSetEmpty {
+    KeyT Key;
+
+public:
+    KeyT &GetFirst() { return Key; }
+    const KeyT &GetFirst() const { return Key; }
+    HashSetEmpty &GetSecond() { return *this; }
+    const HashSetEmpty &GetSecond() const { return *this; }
+};
+
+/// HashSetIterator - Iterates the keys of a HashSet by wrapping an iterator
+/// of its map. Keys of a set can't be changed in place, so both iterator and
+/// const_iterator yield const references.
+template <typename KeyT, typename MapIteratorT>
+class HashSetIterator {
+    template <typename, typename>
+    friend class HashSetIterator;
+    template <typename, typename, typename>
+    friend class HashSetImpl;
+
+    MapIteratorT I;
+
+public:
+    using difference_type = ptrdiff_t;
+    using value_type = KeyT;
+    using pointer = const KeyT *;
+    using reference = const KeyT &;
+    using iterator_category = std::forward_iterator_tag;
+
+    HashSetIterator() = default;
+    explicit HashSetIterator(const MapIteratorT &I) : I(I) {}
+
+    template <typename SrcIteratorT>
+    HashSetIterator(const HashSetIterator<KeyT, SrcIteratorT> &Src)
+        : I(Src.I) {}
+
+    reference operator*() const { return I->GetFirst(); }
+    pointer operator->() const { return &I->GetFirst(); }
+
+    template <typename RHSIteratorT>
+    bool operator==(const HashSetIterator<KeyT, RHSIteratorT> &RHS) const {
+        return I == RHS.I;
+    }
+    template <typename RHSIteratorT>
+    bool operator!=(const HashSetIterator<KeyT, RHSIteratorT> &RHS) const {
+        return I != RHS.I;
+    }
+
+    HashSetIterator &operator++() {  // Preincrement
+        ++I;
+        return *this;
+    }
+    HashSetIterator operator++(int) {  // Postincrement
+        HashSetIterator tmp = *this;
+        ++*this;
+        return tmp;
+    }
+};
+
+/// HashSetImpl - The common implementation of HashSet and SmallHashSet on
+/// top of a map from keys to HashSetEmpty, whose buckets are HashSetPair.
+template <typename DerivedT, typename KeyT, typename MapT>
+class HashSetImpl {
+    static_assert(sizeof(typename MapT::value_type) == sizeof(KeyT),
+                  "The empty value mustn't take space in the buckets!");
+
+    MapT TheMap;
+
+public:
+    using size_type = typename MapT::size_type;
+    using key_type = KeyT;
+    using value_type = KeyT;
+    using allocator_type = typename MapT::allocator_type;
+    using iterator = HashSetIterator<KeyT, typename MapT::iterator>;
+    using const_iterator = HashSetIterator<KeyT, typename MapT::const_iterator>;
+
+    /// Create a set in which \p InitialReserve keys can be inserted without
+    /// growing it.
+    explicit HashSetImpl(size_type InitialReserve = 0) {
+        reserve(InitialReserve);
+    }
+
+    HashSetImpl(size_type InitialReserve, const allocator_type &Alloc)
+        : TheMap(Alloc) {
+        reserve(InitialReserve);
+    }
+
+    template <typename InputIt>
+    HashSetImpl(const InputIt &I, const InputIt &E)
+        : HashSetImpl(std::distance(I, E)) {
+        insert(I, E);
+    }
+
+    HashSetImpl(std::initializer_list<KeyT> Keys)
+        : HashSetImpl(Keys.begin(), Keys.end()) {}
+
+    allocator_type get_allocator() const { return TheMap.get_allocator(); }
+
+    bool empty() const { return TheMap.empty(); }
+    size_type size() const { return TheMap.size(); }
+    size_t getMemorySize() const { return TheMap.getMemorySize(); }
+
+    void clear() { TheMap.clear(); }
+    void reserve(size_type Size) { TheMap.reserve(Size); }
+
+    /// compact - Turn the tombstones left by erase() back into empty
+    /// buckets. Invalidates iterators.
+    void compact() { TheMap.compact(); }
+
+    void swap(DerivedT &RHS) { TheMap.swap(RHS.TheMap); }
+
+    iterator begin() { return iterator(TheMap.begin()); }
+    iterator end() { return iterator(TheMap.end()); }
+    const_iterator begin() const { return const_iterator(TheMap.begin()); }
+    const_iterator end() const { return const_iterator(TheMap.end()); }
+
+    /// Return 1 if the specified key is in the set, 0 otherwise.
+    size_type count(const KeyT &Val) const { return TheMap.count(Val); }
+
+    bool contains(const KeyT &Val) const { return TheMap.count(Val) != 0; }
+
+    iterator find(const KeyT &Val) { return iterator(TheMap.find(Val)); }
+    const_iterator find(const KeyT &Val) const {
+        return const_iterator(TheMap.find(Val));
+    }
+
+    /// Alternate version of find() which allows a different, and possibly
+    /// less expensive, key type.
+    template <class LookupKeyT>
+    iterator find_as(const LookupKeyT &Val) {
+        return iterator(TheMap.find_as(Val));
+    }
+    template <class LookupKeyT>
+    const_iterator find_as(const LookupKeyT &Val) const {
+        return const_iterator(TheMap.find_as(Val));
+    }
+
+    /// insert - Insert \p Val if it isn't in the set yet. The bool is false
+    /// if it already was.
+    std::pair<iterator, bool> insert(const KeyT &Val) {
+        auto Res = TheMap.try_emplace(Val);
+        return std::make_pair(iterator(Res.first), Res.second);
+    }
+    std::pair<iterator, bool> insert(KeyT &&Val) {
+        auto Res = TheMap.try_emplace(std::move(Val));
+        return std::make_pair(iterator(Res.first), Res.second);
+    }
+
+    /// insert - Range insertion of keys.
+    template <typename InputIt>
+    void insert(InputIt I, InputIt E) {
+        for (; I != E; ++I) insert(*I);
+    }
+
+    bool erase(const KeyT &Val) { return TheMap.erase(Val); }
+    void erase(iterator I) { TheMap.erase(I.I); }
+
+    /// Two sets are equal if they hold the same keys.
+    bool operator==(const HashSetImpl &RHS) const {
+        if (size() != RHS.size()) return false;
+        for (const KeyT &Key : *this)
+            if (!RHS.contains(Key)) return false;
+        return true;
+    }
+    bool operator!=(const HashSetImpl &RHS) const { return !(*this == RHS); }
+};
+
+}  // end namespace detail
+
+/// HashSet - A set of keys with the layout and probing of HashMap, minus the
+/// values: the buckets hold just the key, so a HashSet<uint64_t> needs half
+/// the memory of a HashMap<uint64_t, bool>.
+template <typename KeyT, typename KeyInfoT = HashMapInfo<KeyT>,
+          typename ProbeT = QuadraticProbing,
+          typename AllocatorT = std::allocator<detail::HashSetPair<KeyT>>>
+class HashSet
+    : public detail::HashSetImpl<
+          HashSet<KeyT, KeyInfoT, ProbeT, AllocatorT>, KeyT,
+          HashMap<KeyT, detail::HashSetEmpty, KeyInfoT,
+                  detail::HashSetPair<KeyT>, ProbeT, AllocatorT>> {
+    using BaseT = detail::HashSetImpl<
+        HashSet, KeyT,
+        HashMap<KeyT, detail::HashSetEmpty, KeyInfoT, detail::HashSetPair<KeyT>,
+                ProbeT, AllocatorT>>;
+
+public:
+    using BaseT::BaseT;
+    HashSet() = default;
+};
+
+/// SmallHashSet - A HashSet that keeps up to \p InlineBuckets buckets inside
+/// the object, as SmallHashMap does.
+template <typename KeyT, unsigned InlineBuckets = 4,
+          typename KeyInfoT = HashMapInfo<KeyT>,
+          typename ProbeT = QuadraticProbing,
+          typename AllocatorT = std::allocator<detail::HashSetPair<KeyT>>>
+class SmallHashSet
+    : public detail::HashSetImpl<
+          SmallHashSet<KeyT, InlineBuckets, KeyInfoT, ProbeT, AllocatorT>,
+          KeyT,
+          SmallHashMap<KeyT, detail::HashSetEmpty, InlineBuckets, KeyInfoT,
+                       detail::HashSetPair<KeyT>, ProbeT, AllocatorT>> {
+    using BaseT = detail::HashSetImpl<
+        SmallHashSet, KeyT,
+        SmallHashMap<KeyT, detail::HashSetEmpty, InlineBuckets, KeyInfoT,
+                     detail::HashSetPair<KeyT>, ProbeT, AllocatorT>>;
+
+public:
+    using BaseT::BaseT;
+    SmallHashSet() = default;
+};
+
+/// set_union - Return the keys in \p LHS or \p RHS. The larger set is copied
+/// and the smaller one inserted into the copy.
+template <typename DerivedT, typename KeyT, typename MapT>
+DerivedT set_union(const detail::HashSetImpl<DerivedT, KeyT, MapT> &LHS,
+                   const detail::HashSetImpl<DerivedT, KeyT, MapT> &RHS) {
+    const bool LHSIsLarger = LHS.size() >= RHS.size();
+    const auto &Larger = LHSIsLarger ? LHS : RHS;
+    const auto &Smaller = LHSIsLarger ? RHS : LHS;
+    DerivedT Result(static_cast<const DerivedT &>(Larger));
+    Result.insert(Smaller.begin(), Smaller.end());
+    return Result;
+}
+
+/// set_intersection - Return the keys in both \p LHS and \p RHS. The smaller
+/// set is iterated and each of its keys looked up in the larger one.
+template <typename DerivedT, typename KeyT, typename MapT>
+DerivedT set_intersection(
+    const detail::HashSetImpl<DerivedT, KeyT, MapT> &LHS,
+    const detail::HashSetImpl<DerivedT, KeyT, MapT> &RHS) {
+    const bool LHSIsLarger = LHS.size() >= RHS.size();
+    const auto &Larger = LHSIsLarger ? LHS : RHS;
+    const auto &Smaller = LHSIsLarger ? RHS : LHS;
+    DerivedT Result;
+    for (const KeyT &Key : Smaller)
+        if (Larger.contains(Key)) Result.insert(Key);
+    return Result;
+}
+
+/// set_difference - Return the keys in \p LHS but not in \p RHS. If \p LHS
+/// is the smaller set its keys are looked up in \p RHS; otherwise \p LHS is
+/// copied and the keys of \p RHS erased from the copy.
+template <typename DerivedT, typename KeyT, typename MapT>
+DerivedT set_difference(
+    const detail::HashSetImpl<DerivedT, KeyT, MapT> &LHS,
+    const detail::HashSetImpl<DerivedT, KeyT, MapT> &RHS) {
+    if (LHS.size() <= RHS.size()) {
+        DerivedT Result;
+        for (const KeyT &Key : LHS)
+            if (!RHS.contains(Key)) Result.insert(Key);
+        return Result;
+    }
+    DerivedT Result(static_cast<const DerivedT &>(LHS));
+    for (const KeyT &Key : RHS) Result.erase(Key);
+    Result.compact();
+    return Result;
+}
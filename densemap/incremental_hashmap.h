@@ -0,0 +1,501 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "densemap/hashmap.h"
+
+/// IncrementalHashMap - A HashMap whose Grow() does not rehash the whole
+/// table in one call. When the table fills up, a new bucket array is
+/// allocated and the old one is kept alongside it; every insert or erase then
+/// migrates a bounded number of old buckets into the new table, and lookups
+/// consult both tables until the migration is done. This bounds the latency
+/// of the insert that triggers a resize at the cost of slightly slower
+/// operations while a migration is in progress.
+///
+/// Initializing the new bucket array is itself linear in its size, so that
+/// work is spread out too: once the current table is 3/8 full, every insert
+/// or erase also initializes a few buckets of the next table, which is then
+/// ready by the time the current one needs to be replaced.
+///
+/// Inserting and erasing may move entries between the two tables, so both
+/// invalidate iterators and references, unlike HashMap::erase.
+template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
+          typename BucketT = detail::HashMapPair<KeyT, ValueT>,
+          typename ProbeT = QuadraticProbing>
+class IncrementalHashMap {
+    template <typename T>
+    using const_arg_type_t = typename const_pointer_or_const_ref<T>::type;
+
+    using MapT = HashMap<KeyT, ValueT, KeyInfoT, BucketT, ProbeT>;
+    using BaseT = HashMapBase<MapT, KeyT, ValueT, KeyInfoT, BucketT, ProbeT>;
+    using BucketHashTraits = typename BaseT::BucketHashTraits;
+    using HashT = typename BaseT::HashT;
+
+    // Migration walks the old table bucket by bucket, which entries shifted
+    // by erase() would slip past.
+    static_assert(!ProbeT::MovesEntries,
+                  "IncrementalHashMap needs a policy that leaves tombstones!");
+
+    template <bool IsConst>
+    class Iterator;
+
+    MapT Active;    // Receives every insertion.
+    MapT Draining;  // The old table while a migration is in progress.
+    typename MapT::size_type MigratePos = 0;  // Next bucket to migrate.
+    typename MapT::size_type DestroyPos = 0;  // Next key to destroy.
+    BucketT *Staged = nullptr;     // The next table, if being prepared.
+    typename MapT::size_type StagedBuckets = 0;
+    // Number of staged buckets initialized.
+    typename MapT::size_type StagedInitPos = 0;
+    unsigned MigrateStep;
+
+public:
+    using size_type = typename MapT::size_type;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = BucketT;
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /// Create a map that can hold \p InitialReserve entries without a resize
+    /// and migrates \p MigrateStep old buckets per insert or erase. A step of
+    /// at least 4 guarantees a migration finishes before the new table can
+    /// fill up again.
+    explicit IncrementalHashMap(size_type InitialReserve = 0,
+                                unsigned MigrateStep = 8)
+        : Active(InitialReserve), MigrateStep(MigrateStep) {
+        assert(MigrateStep >= 4 && "Migration could fall behind insertion!");
+        disableCompaction();
+    }
+
+    IncrementalHashMap(const IncrementalHashMap &other)
+        : Active(other.Active), MigrateStep(other.MigrateStep) {
+        disableCompaction();
+        if (other.isMigrating())
+            for (const BucketT &B : other.Draining)
+                Active.try_emplace(B.GetFirst(), B.GetSecond());
+    }
+
+    IncrementalHashMap(IncrementalHashMap &&other)
+        : MigrateStep(other.MigrateStep) {
+        disableCompaction();
+        swap(other);
+    }
+
+    ~IncrementalHashMap() {
+        // A table whose keys are being destroyed can't be left to ~HashMap.
+        if (!isMigrating()) migrate(~size_type(0));
+        discardStaged();
+    }
+
+    IncrementalHashMap &operator=(IncrementalHashMap other) {
+        swap(other);
+        return *this;
+    }
+
+    void swap(IncrementalHashMap &RHS) {
+        Active.swap(RHS.Active);
+        Draining.swap(RHS.Draining);
+        std::swap(MigratePos, RHS.MigratePos);
+        std::swap(DestroyPos, RHS.DestroyPos);
+        std::swap(Staged, RHS.Staged);
+        std::swap(StagedBuckets, RHS.StagedBuckets);
+        std::swap(StagedInitPos, RHS.StagedInitPos);
+        std::swap(MigrateStep, RHS.MigrateStep);
+    }
+
+    iterator begin() {
+        if (isMigrating()) return iterator(this, Draining.begin(), true);
+        return iterator(this, Active.begin(), false);
+    }
+    iterator end() { return iterator(this, Active.end(), false); }
+    const_iterator begin() const {
+        if (isMigrating()) return const_iterator(this, Draining.begin(), true);
+        return const_iterator(this, Active.begin(), false);
+    }
+    const_iterator end() const {
+        return const_iterator(this, Active.end(), false);
+    }
+
+    bool empty() const { return size() == 0; }
+    size_type size() const { return Active.size() + Draining.size(); }
+
+    /// Return true while entries remain in the old table.
+    bool isMigrating() const { return !Draining.empty(); }
+
+    /// Finish any pending migration, then make room for \p num_entries_.
+    void reserve(size_type num_entries_) {
+        migrate(~size_type(0));
+        discardStaged();
+        Active.reserve(num_entries_);
+    }
+
+    void clear() {
+        if (isMigrating()) {
+            // Assignment takes the fresh map's tombstone percentage too, and
+            // Draining becomes Active at the next migration.
+            Draining = MapT();
+            disableCompaction();
+        }
+        migrate(~size_type(0));
+        discardStaged();
+        Active.clear();
+    }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    size_type count(const_arg_type_t<KeyT> Val) const {
+        bool InDraining;
+        return lookupBucket(Val, InDraining) ? 1 : 0;
+    }
+
+    iterator find(const_arg_type_t<KeyT> Val) {
+        bool InDraining;
+        if (const BucketT *B = lookupBucket(Val, InDraining))
+            return makeIterator(const_cast<BucketT *>(B), InDraining);
+        return end();
+    }
+    const_iterator find(const_arg_type_t<KeyT> Val) const {
+        bool InDraining;
+        if (const BucketT *B = lookupBucket(Val, InDraining))
+            return makeConstIterator(B, InDraining);
+        return end();
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    ValueT lookup(const_arg_type_t<KeyT> Val) const {
+        bool InDraining;
+        if (const BucketT *B = lookupBucket(Val, InDraining))
+            return B->GetSecond();
+        return ValueT();
+    }
+
+    std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+        return try_emplace(KV.first, KV.second);
+    }
+
+    std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+        return try_emplace(std::move(KV.first), std::move(KV.second));
+    }
+
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+        BucketT *B;
+        bool InDraining;
+        const HashT Hash = KeyInfoT::GetHashValue(Key);
+        if (findOrPrepareInsert(Key, Hash, B, InDraining))
+            return std::make_pair(makeIterator(B, InDraining),
+                                  false);  // Already in map.
+
+        B = static_cast<BaseT &>(Active).InsertIntoBucket(
+            B, Hash, std::move(Key), std::forward<Ts>(Args)...);
+        return std::make_pair(makeIterator(B, false), true);
+    }
+
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+        BucketT *B;
+        bool InDraining;
+        const HashT Hash = KeyInfoT::GetHashValue(Key);
+        if (findOrPrepareInsert(Key, Hash, B, InDraining))
+            return std::make_pair(makeIterator(B, InDraining),
+                                  false);  // Already in map.
+
+        B = static_cast<BaseT &>(Active).InsertIntoBucket(
+            B, Hash, Key, std::forward<Ts>(Args)...);
+        return std::make_pair(makeIterator(B, false), true);
+    }
+
+    ValueT &operator[](const KeyT &Key) {
+        return try_emplace(Key).first->GetSecond();
+    }
+
+    ValueT &operator[](KeyT &&Key) {
+        return try_emplace(std::move(Key)).first->GetSecond();
+    }
+
+    bool erase(const KeyT &Val) {
+        step();
+        bool InDraining;
+        const BucketT *B = lookupBucket(Val, InDraining);
+        if (!B) return false;  // not in map.
+
+        MapT &Table = InDraining ? Draining : Active;
+        Table.erase(typename MapT::iterator(
+            const_cast<BucketT *>(B),
+            static_cast<BaseT &>(Table).getBucketsend(), true));
+        return true;
+    }
+
+private:
+    template <bool IsConst>
+    class Iterator {
+        friend class IncrementalHashMap;
+        template <bool>
+        friend class Iterator;
+
+        using OwnerT = typename std::conditional<IsConst,
+                                                 const IncrementalHashMap,
+                                                 IncrementalHashMap>::type;
+        using TableIterator =
+            typename std::conditional<IsConst, typename MapT::const_iterator,
+                                      typename MapT::iterator>::type;
+
+        OwnerT *Owner = nullptr;
+        TableIterator Ptr;
+        bool InDraining = false;
+
+        Iterator(OwnerT *Owner, TableIterator Ptr, bool InDraining)
+            : Owner(Owner), Ptr(Ptr), InDraining(InDraining) {
+            AdvancePastDraining();
+        }
+
+        // Step from the end of the old table to the start of the new one.
+        void AdvancePastDraining() {
+            if (InDraining && Ptr == Owner->Draining.end()) {
+                Ptr = Owner->Active.begin();
+                InDraining = false;
+            }
+        }
+
+    public:
+        using difference_type = ptrdiff_t;
+        using value_type =
+            typename std::conditional<IsConst, const BucketT, BucketT>::type;
+        using pointer = value_type *;
+        using reference = value_type &;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+
+        template <bool IsConstSrc,
+                  typename = typename std::enable_if<!IsConstSrc &&
+                                                     IsConst>::type>
+        Iterator(const Iterator<IsConstSrc> &I)
+            : Owner(I.Owner), Ptr(I.Ptr), InDraining(I.InDraining) {}
+
+        reference operator*() const { return *Ptr; }
+        pointer operator->() const { return &*Ptr; }
+
+        bool operator==(const Iterator<true> &RHS) const {
+            return Ptr == RHS.Ptr;
+        }
+        bool operator!=(const Iterator<true> &RHS) const {
+            return Ptr != RHS.Ptr;
+        }
+
+        Iterator &operator++() {  // Preincrement
+            ++Ptr;
+            AdvancePastDraining();
+            return *this;
+        }
+        Iterator operator++(int) {  // Postincrement
+            Iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+    };
+
+    iterator makeIterator(BucketT *B, bool InDraining) {
+        MapT &Table = InDraining ? Draining : Active;
+        return iterator(this,
+                        typename MapT::iterator(
+                            B, static_cast<BaseT &>(Table).getBucketsend(),
+                            true),
+                        InDraining);
+    }
+
+    const_iterator makeConstIterator(const BucketT *B, bool InDraining) const {
+        const MapT &Table = InDraining ? Draining : Active;
+        return const_iterator(
+            this,
+            typename MapT::const_iterator(
+                B, static_cast<const BaseT &>(Table).getBucketsend(), true),
+            InDraining);
+    }
+
+    static bool isLive(const BucketT &B) {
+        return !KeyInfoT::IsEqual(B.GetFirst(), KeyInfoT::GetEmptyKey()) &&
+               !KeyInfoT::IsEqual(B.GetFirst(), KeyInfoT::GetTombstoneKey());
+    }
+
+    /// Return the bucket holding Val in either table, hashing it only once.
+    template <typename LookupKeyT>
+    const BucketT *lookupBucket(const LookupKeyT &Val,
+                                bool &InDraining) const {
+        const HashT Hash = KeyInfoT::GetHashValue(Val);
+        const BucketT *B;
+        InDraining = false;
+        if (static_cast<const BaseT &>(Active).LookupBucketFor(Val, Hash, B))
+            return B;
+        InDraining = true;
+        if (isMigrating() &&
+            static_cast<const BaseT &>(Draining).LookupBucketFor(Val, Hash, B))
+            return B;
+        return nullptr;
+    }
+
+    /// Do a step of background work, then look Key up in both tables. If it is in neither,
+    /// start a migration when the new table is full and return the bucket of
+    /// the new table Key should be inserted into.
+    template <typename LookupKeyT>
+    bool findOrPrepareInsert(const LookupKeyT &Key, HashT Hash,
+                             BucketT *&B, bool &InDraining) {
+        step();
+
+        BaseT &New = Active;
+        InDraining = false;
+        if (New.LookupBucketFor(Key, Hash, B)) return true;
+        if (isMigrating()) {
+            BucketT *OldBucket;
+            if (static_cast<BaseT &>(Draining).LookupBucketFor(Key, Hash,
+                                                               OldBucket)) {
+                B = OldBucket;
+                InDraining = true;
+                return true;
+            }
+        }
+
+        // An empty table has nothing to migrate, so let it grow by itself.
+        size_type AtLeast;
+        if (New.getNumBukets() != 0 &&
+            New.shouldGrow(Active.size() + 1, AtLeast)) {
+            beginMigration(AtLeast);
+            New.LookupBucketFor(Key, Hash, B);
+        }
+        return false;
+    }
+
+    /// Tombstones are cleaned up by same-size migrations instead, so neither
+    /// table may stall an insertion with an in-place compaction.
+    void disableCompaction() {
+        Active.setMaxTombstonePercent(0);
+        Draining.setMaxTombstonePercent(0);
+    }
+
+    /// Advance the pending migration and the preparation of the next table.
+    void step() {
+        migrate(MigrateStep);
+        prepareNextTable(2 * MigrateStep);
+    }
+
+    /// Retire the current table and start filling a new one of at least
+    /// \p AtLeast buckets.
+    void beginMigration(size_type AtLeast) {
+        // Only happens if MigrateStep is too small to keep up.
+        migrate(~size_type(0));
+
+        // A same-size rehash only cleans up tombstones. Double instead when
+        // live entries fill half the table, so the new table can't fill up
+        // before the migration ends.
+        const size_type NumBuckets =
+            static_cast<BaseT &>(Active).getNumBukets();
+        if (AtLeast == NumBuckets && Active.size() * 2 >= NumBuckets)
+            AtLeast = NumBuckets * 2;
+
+        // The staged table was sized when it was started; fall back to
+        // allocating one now if the table has filled up faster than expected.
+        if (Staged && StagedBuckets < AtLeast) discardStaged();
+
+        Draining.swap(Active);
+        if (Staged) {
+            prepareNextTable(~size_type(0));
+            Active.adoptBuckets(Staged, StagedBuckets);
+            Staged = nullptr;
+        } else {
+            Active.Grow(AtLeast);
+        }
+        MigratePos = 0;
+        DestroyPos = 0;
+    }
+
+    /// Initialize up to \p Budget buckets of the table that will replace the
+    /// current one, allocating it first if the current table is 3/8 full.
+    void prepareNextTable(size_type Budget) {
+        if (!Staged) {
+            const BaseT &Cur = Active;
+            const size_type NumBuckets = Cur.getNumBukets();
+            if (NumBuckets == 0 ||
+                (Active.size() + Cur.num_to_mbstones()) * 8 < NumBuckets * 3)
+                return;
+            // Mostly tombstones only need a same-size rehash.
+            StagedBuckets = Active.size() * 8 >= NumBuckets * 3
+                                ? NumBuckets * 2
+                                : NumBuckets;
+            Staged = Active.allocateBucketArray(StagedBuckets);
+            StagedInitPos = 0;
+        }
+        if (StagedInitPos == StagedBuckets) return;
+
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        for (; Budget && StagedInitPos != StagedBuckets;
+             --Budget, ++StagedInitPos) {
+            ::new (&Staged[StagedInitPos].GetFirst()) KeyT(EmptyKey);
+            BucketHashTraits::SetHash(Staged[StagedInitPos], 0);
+        }
+        if (StagedInitPos == StagedBuckets)
+            ProbeT::initMetadata(
+                reinterpret_cast<uint8_t *>(Staged + StagedBuckets),
+                StagedBuckets);
+    }
+
+    void discardStaged() {
+        if (!Staged) return;
+        if (!std::is_trivially_destructible<KeyT>::value)
+            for (size_type i = 0; i != StagedInitPos; ++i)
+                Staged[i].GetFirst().~KeyT();
+        Active.deallocateBucketArray(Staged, StagedBuckets);
+        Staged = nullptr;
+        StagedBuckets = 0;
+        StagedInitPos = 0;
+    }
+
+    /// Move the live entries of up to \p Budget old buckets into the new
+    /// table. Once the old table is empty, spend the remaining budget on
+    /// destroying its keys, and free it when all are gone.
+    void migrate(size_type Budget) {
+        BaseT &Old = Draining;
+        const size_type NumBuckets = Old.getNumBukets();
+        if (NumBuckets == 0) return;
+        BucketT *Buckets = Old.getBuckets();
+
+        // Migrated buckets become tombstones so the probe sequences of the
+        // entries still in the old table stay intact.
+        while (Budget && isMigrating()) {
+            assert(MigratePos < NumBuckets && "Lost track of live entries!");
+            BucketT *B = Buckets + MigratePos++;
+            --Budget;
+            if (!isLive(*B)) continue;
+            moveToActive(*B);
+            Draining.erase(
+                typename MapT::iterator(B, Buckets + NumBuckets, true));
+        }
+        if (isMigrating()) return;
+
+        // Nothing probes the old table anymore.
+        if (!std::is_trivially_destructible<KeyT>::value) {
+            for (; Budget && DestroyPos != NumBuckets; --Budget, ++DestroyPos)
+                Buckets[DestroyPos].GetFirst().~KeyT();
+            if (DestroyPos != NumBuckets) return;
+        }
+        Draining.deallocateBucketArray(Buckets, NumBuckets);
+        Draining.init(0);
+    }
+
+    void moveToActive(BucketT &B) {
+        BaseT &New = Active;
+        const HashT Hash = BucketHashTraits::template GetHash<KeyInfoT>(B);
+        BucketT *Dest;
+        bool FoundVal = New.LookupBucketFor(B.GetFirst(), Hash, Dest);
+        (void)FoundVal;  // silence warning.
+        assert(!FoundVal && "Key in both tables?");
+        New.InsertIntoBucket(Dest, Hash, std::move(B.GetFirst()),
+                             std::move(B.GetSecond()));
+    }
+};
@@ -0,0 +1,321 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "common/math_utils.h"
+#include "densemap/hashmap.h"
+#include "vector/smallvector.h"
+
+/// IndexMap - A map that keeps its entries in insertion order in a dense
+/// SmallVector, with a hash index of 32-bit entry numbers to find them.
+/// Iteration is a scan of the entry vector, which holds no empty or deleted
+/// slots, and visits the entries in the order they were inserted. The index
+/// is probed as ProbeT orders its buckets, but takes 4 bytes per slot
+/// whatever the size of the entries, so a sparse table costs little to keep
+/// and growing it moves no entries, only rewrites the index.
+///
+/// erase() moves the last entry into the place of the erased one, which
+/// takes constant time but changes the order of that entry. remove_if()
+/// erases in one compaction pass that keeps the order of the rest.
+///
+/// Inserting invalidates iterators and references when the entry vector
+/// grows; erasing invalidates those to the last entry.
+template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
+          typename ProbeT = QuadraticProbing, unsigned InlineEntries = 0>
+class IndexMap {
+    template <typename T>
+    using const_arg_type_t = typename const_pointer_or_const_ref<T>::type;
+
+    using HashT = typename detail::HashWidthTraits<KeyT, KeyInfoT>::HashT;
+    using EntryT = detail::HashMapPair<KeyT, ValueT>;
+
+    /// Index slots that hold no entry number.
+    enum : uint32_t { EmptySlot = ~0u, TombstoneSlot = ~0u - 1 };
+
+    SmallVector<EntryT, InlineEntries> Entries;
+    std::vector<uint32_t> Slots;
+    size_t NumTombstones = 0;
+
+public:
+    using size_type = unsigned;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = EntryT;
+
+    using iterator = EntryT *;
+    using const_iterator = const EntryT *;
+
+    /// Create an IndexMap in which \p InitialReserve entries can be inserted
+    /// without growing it.
+    explicit IndexMap(size_type InitialReserve = 0) { reserve(InitialReserve); }
+
+    IndexMap(const IndexMap &other) = default;
+
+    IndexMap(IndexMap &&other) { swap(other); }
+
+    template <typename InputIt>
+    IndexMap(const InputIt &I, const InputIt &E)
+        : IndexMap(std::distance(I, E)) {
+        insert(I, E);
+    }
+
+    IndexMap &operator=(IndexMap other) {
+        swap(other);
+        return *this;
+    }
+
+    void swap(IndexMap &RHS) {
+        Entries.Swap(RHS.Entries);
+        Slots.swap(RHS.Slots);
+        std::swap(NumTombstones, RHS.NumTombstones);
+    }
+
+    iterator begin() { return Entries.begin(); }
+    iterator end() { return Entries.end(); }
+    const_iterator begin() const { return Entries.begin(); }
+    const_iterator end() const { return Entries.end(); }
+
+    bool empty() const { return Entries.IsEmpty(); }
+    size_type size() const { return Entries.size(); }
+
+    /// Return the number of slots in the index, empty ones included.
+    size_t getNumBuckets() const { return Slots.size(); }
+
+    /// Return the size in bytes of the entry vector, unused capacity
+    /// included, and of the index.
+    size_t getMemorySize() const {
+        return Entries.capacity() * sizeof(EntryT) +
+               Slots.size() * sizeof(uint32_t);
+    }
+
+    void reserve(size_type NumEntries) {
+        Entries.reserve(NumEntries);
+        const size_t NumSlots = getMinSlotsForEntries(NumEntries);
+        if (NumSlots > Slots.size()) Rebuild(NumSlots);
+    }
+
+    void clear() {
+        Entries.Clear();
+        std::fill(Slots.begin(), Slots.end(), uint32_t(EmptySlot));
+        NumTombstones = 0;
+    }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    size_type count(const_arg_type_t<KeyT> Val) const {
+        return LookupEntry(Val) ? 1 : 0;
+    }
+
+    iterator find(const_arg_type_t<KeyT> Val) { return find_as(Val); }
+    const_iterator find(const_arg_type_t<KeyT> Val) const {
+        return find_as(Val);
+    }
+
+    /// Alternate version of find() which allows a different, and possibly
+    /// less expensive, key type.
+    template <class LookupKeyT>
+    iterator find_as(const LookupKeyT &Val) {
+        if (const EntryT *E = LookupEntry(Val)) return const_cast<EntryT *>(E);
+        return end();
+    }
+    template <class LookupKeyT>
+    const_iterator find_as(const LookupKeyT &Val) const {
+        if (const EntryT *E = LookupEntry(Val)) return E;
+        return end();
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    ValueT lookup(const_arg_type_t<KeyT> Val) const {
+        if (const EntryT *E = LookupEntry(Val)) return E->GetSecond();
+        return ValueT();
+    }
+
+    std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+        return try_emplace(KV.first, KV.second);
+    }
+
+    std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+        return try_emplace(std::move(KV.first), std::move(KV.second));
+    }
+
+    /// insert - Range insertion of pairs.
+    template <typename InputIt>
+    void insert(InputIt I, InputIt E) {
+        for (; I != E; ++I) insert(*I);
+    }
+
+    // Inserts key,value pair at the end of the map if the key isn't already
+    // in the map. The value is constructed in-place if the key is not in the
+    // map, otherwise it is not moved.
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+        return TryEmplace(std::move(Key), std::forward<Ts>(Args)...);
+    }
+
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+        return TryEmplace(Key, std::forward<Ts>(Args)...);
+    }
+
+    value_type &FindAndConstruct(const KeyT &Key) {
+        return *try_emplace(Key).first;
+    }
+
+    ValueT &operator[](const KeyT &Key) { return FindAndConstruct(Key).second; }
+
+    value_type &FindAndConstruct(KeyT &&Key) {
+        return *try_emplace(std::move(Key)).first;
+    }
+
+    ValueT &operator[](KeyT &&Key) {
+        return FindAndConstruct(std::move(Key)).second;
+    }
+
+    bool erase(const KeyT &Val) {
+        iterator I = find(Val);
+        if (I == end()) return false;  // not in map.
+
+        erase(I);
+        return true;
+    }
+
+    /// erase - Erase the entry at \p I by moving the last entry into its
+    /// place.
+    void erase(iterator I) {
+        const uint32_t Pos = I - begin();
+        const uint32_t Last = Entries.size() - 1;
+        Slots[FindSlotOf(Pos)] = TombstoneSlot;
+        ++NumTombstones;
+        if (Pos != Last) {
+            Slots[FindSlotOf(Last)] = Pos;
+            *I = std::move(Entries[Last]);
+        }
+        Entries.PopBack();
+    }
+
+    /// remove_if - Erase every entry for which \p Pred returns true, keeping
+    /// the others in order, and rebuild the index. Returns the number of
+    /// entries erased.
+    template <typename PredT>
+    size_type remove_if(PredT Pred) {
+        iterator NewEnd = std::remove_if(begin(), end(), Pred);
+        const size_type NumErased = end() - NewEnd;
+        if (NumErased == 0) return 0;
+        Entries.Erase(NewEnd, end());
+        Rebuild(Slots.size());
+        return NumErased;
+    }
+
+    /// getStats - Return the occupancy of the index.
+    HashMapStats getStats() const {
+        HashMapStats S;
+        S.Enabled = false;
+        S.NumBuckets = Slots.size();
+        S.NumEntries = size();
+        S.NumTombstones = NumTombstones;
+        return S;
+    }
+
+private:
+    static size_t getMinSlotsForEntries(size_t NumEntries) {
+        if (NumEntries == 0) return 0;
+        // Stay below 3/4 full, as HashMap does.
+        return std::max<size_t>(16, NextPowerOf2(NumEntries * 4 / 3 + 1));
+    }
+
+    template <typename LookupKeyT>
+    const EntryT *LookupEntry(const LookupKeyT &Val) const {
+        if (Slots.empty()) return nullptr;
+        const size_t Slot = ProbeT::FindBucketIf(
+            Slots.size(), HashT(KeyInfoT::GetHashValue(Val)), [&](size_t S) {
+                const uint32_t Pos = Slots[S];
+                return Pos == EmptySlot ||
+                       (Pos != TombstoneSlot &&
+                        KeyInfoT::IsEqual(Val, Entries[Pos].GetFirst()));
+            });
+        return Slots[Slot] == EmptySlot ? nullptr : &Entries[Slots[Slot]];
+    }
+
+    /// LookupSlotFor - Set \p Slot to the index slot of \p Key and return
+    /// true if it's in the map. Otherwise set it to the slot a new entry for
+    /// \p Key should take, reusing the first tombstone on the way, and
+    /// return false.
+    bool LookupSlotFor(const KeyT &Key, HashT Hash, size_t &Slot) const {
+        size_t FirstTombstone = ~size_t(0);
+        Slot = ProbeT::FindBucketIf(Slots.size(), Hash, [&](size_t S) {
+            const uint32_t Pos = Slots[S];
+            if (Pos == TombstoneSlot) {
+                if (FirstTombstone == ~size_t(0)) FirstTombstone = S;
+                return false;
+            }
+            return Pos == EmptySlot ||
+                   KeyInfoT::IsEqual(Key, Entries[Pos].GetFirst());
+        });
+        if (Slots[Slot] != EmptySlot) return true;
+        if (FirstTombstone != ~size_t(0)) Slot = FirstTombstone;
+        return false;
+    }
+
+    /// FindSlotOf - Return the index slot that holds entry number \p Pos.
+    size_t FindSlotOf(uint32_t Pos) const {
+        const HashT Hash = KeyInfoT::GetHashValue(Entries[Pos].GetFirst());
+        return ProbeT::FindBucketIf(Slots.size(), Hash, [&](size_t S) {
+            return Slots[S] == Pos;
+        });
+    }
+
+    size_t FindEmptySlot(HashT Hash) const {
+        return ProbeT::FindBucketIf(Slots.size(), Hash, [&](size_t S) {
+            return Slots[S] == EmptySlot;
+        });
+    }
+
+    template <typename KeyArgT, typename... Ts>
+    std::pair<iterator, bool> TryEmplace(KeyArgT &&Key, Ts &&... Args) {
+        const HashT Hash = KeyInfoT::GetHashValue(Key);
+        size_t Slot = 0;
+        if (!Slots.empty() && LookupSlotFor(Key, Hash, Slot))
+            return std::make_pair(begin() + Slots[Slot],
+                                  false);  // Already in map.
+
+        // Grow the index once it would be more than 3/4 full, or rebuild it
+        // at the same size when fewer than 1/8 of its slots stay empty, as
+        // HashMap does.
+        const size_t NewSize = size() + 1;
+        if (NewSize * 4 > Slots.size() * 3) {
+            Rebuild(std::max(Slots.size() * 2, getMinSlotsForEntries(NewSize)));
+            Slot = FindEmptySlot(Hash);
+        } else if ((NewSize + NumTombstones) * 8 > Slots.size() * 7) {
+            Rebuild(Slots.size());
+            Slot = FindEmptySlot(Hash);
+        }
+
+        assert(Entries.size() < TombstoneSlot && "Too many entries!");
+        const uint32_t Pos = Entries.size();
+        if (Entries.size() == Entries.capacity()) Entries.reserve(Pos + 1);
+        EntryT *E = Entries.end();
+        ::new (&E->GetFirst()) KeyT(std::forward<KeyArgT>(Key));
+        ::new (&E->GetSecond()) ValueT(std::forward<Ts>(Args)...);
+        Entries.set_size(Pos + 1);
+
+        if (Slots[Slot] == TombstoneSlot) --NumTombstones;
+        Slots[Slot] = Pos;
+        return std::make_pair(begin() + Pos, true);
+    }
+
+    /// Rebuild - Make the index \p NumSlots slots large and enter every
+    /// entry in it, dropping the tombstones.
+    void Rebuild(size_t NumSlots) {
+        Slots.assign(NumSlots, EmptySlot);
+        NumTombstones = 0;
+        for (uint32_t Pos = 0, E = Entries.size(); Pos != E; ++Pos)
+            Slots[FindEmptySlot(KeyInfoT::GetHashValue(
+                Entries[Pos].GetFirst()))] = Pos;
+    }
+};
@@ -0,0 +1,277 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "densemap/hashmap.h"
+
+namespace detail {
+
+/// HashMapImageHeader - The start of a file written by writeHashMapImage().
+/// The bucket array, followed by the probing metadata, starts at
+/// BucketsOffset and is a byte-for-byte copy of the table it was written
+/// from, so a reader that agrees on every field can probe it in place.
+struct HashMapImageHeader {
+    static constexpr uint32_t CurrentVersion = 1;
+    static constexpr uint32_t ByteOrderMark = 0x01020304;
+    /// The bucket array starts on a page boundary of the mapped file.
+    static constexpr uint64_t BucketsAlignment = 4096;
+
+    char Magic[8];
+    uint32_t Version;
+    uint32_t ByteOrder;
+    uint32_t NumBuckets;
+    uint32_t NumEntries;
+    uint32_t BucketSize;
+    uint32_t BucketAlign;
+    uint32_t KeySize;
+    uint32_t ValueSize;
+    uint32_t MetadataSize;
+    /// KeyInfoT::GetHashValue of the empty key, so that a reader built with
+    /// a different hash function is rejected instead of missing every key.
+    uint32_t EmptyKeyHash;
+    uint64_t BucketsOffset;
+    uint64_t ImageSize;
+
+    static const char *getMagic() { return "HMAPIMG"; }
+
+    template <typename KeyT, typename ValueT, typename KeyInfoT,
+              typename BucketT, typename ProbeT>
+    static HashMapImageHeader get(unsigned NumBuckets, unsigned NumEntries) {
+        HashMapImageHeader H;
+        std::memset(&H, 0, sizeof(H));
+        std::memcpy(H.Magic, getMagic(), sizeof(H.Magic));
+        H.Version = CurrentVersion;
+        H.ByteOrder = ByteOrderMark;
+        H.NumBuckets = NumBuckets;
+        H.NumEntries = NumEntries;
+        H.BucketSize = sizeof(BucketT);
+        H.BucketAlign = alignof(BucketT);
+        H.KeySize = sizeof(KeyT);
+        H.ValueSize = sizeof(ValueT);
+        H.MetadataSize = ProbeT::getMetadataSize(NumBuckets);
+        H.EmptyKeyHash = KeyInfoT::GetHashValue(KeyInfoT::GetEmptyKey());
+        H.BucketsOffset = BucketsAlignment;
+        H.ImageSize = H.BucketsOffset +
+                      uint64_t(NumBuckets) * sizeof(BucketT) + H.MetadataSize;
+        return H;
+    }
+};
+
+}  // end namespace detail
+
+/// writeHashMapImage - Write \p Map to the file \p Path as an image that
+/// MappedHashMap can map and query without rebuilding the table. Keys and
+/// values are stored as raw bytes, so they must be trivially copyable and
+/// must not point into the process that wrote them. Returns false if the
+/// file couldn't be written.
+template <typename DerivedT, typename KeyT, typename ValueT, typename KeyInfoT,
+          typename BucketT, typename ProbeT>
+bool writeHashMapImage(
+    const HashMapBase<DerivedT, KeyT, ValueT, KeyInfoT, BucketT, ProbeT> &Map,
+    const char *Path) {
+    static_assert(isPodLike<KeyT>::value && isPodLike<ValueT>::value,
+                  "Only trivially copyable keys and values can be mapped!");
+    using HeaderT = detail::HashMapImageHeader;
+    assert(uint64_t(Map.getNumBuckets()) <= UINT32_MAX &&
+           "Image headers hold 32-bit bucket counts!");
+    const HeaderT Header =
+        HeaderT::template get<KeyT, ValueT, KeyInfoT, BucketT, ProbeT>(
+            Map.getNumBuckets(), Map.size());
+    assert(Header.ImageSize - Header.BucketsOffset == Map.getMemorySize());
+
+    std::FILE *F = std::fopen(Path, "wb");
+    if (!F) return false;
+    static const char Zeros[HeaderT::BucketsAlignment] = {};
+    bool Ok = std::fwrite(&Header, sizeof(Header), 1, F) == 1 &&
+              std::fwrite(Zeros, Header.BucketsOffset - sizeof(Header), 1, F) ==
+                  1;
+    // The buckets and their metadata are one contiguous block.
+    if (Ok && Map.getNumBuckets() != 0)
+        Ok = std::fwrite(Map.getPointerIntoBucketsArray(),
+                         Map.getMemorySize(), 1, F) == 1;
+    Ok = std::fclose(F) == 0 && Ok;
+    return Ok;
+}
+
+/// MappedHashMap - A read-only view of an image written by
+/// writeHashMapImage(). open() maps the file and checks that it was written
+/// from a map with the same key, value and bucket layout, probing policy and
+/// hash function; lookups then probe the mapped bucket array directly.
+/// Opening costs the same whatever the size of the table, pages are read
+/// from disk as lookups touch them, and processes that map the same image
+/// share it in the page cache.
+template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
+          typename BucketT = detail::HashMapPair<KeyT, ValueT>,
+          typename ProbeT = QuadraticProbing>
+class MappedHashMap {
+    static_assert(isPodLike<KeyT>::value && isPodLike<ValueT>::value,
+                  "Only trivially copyable keys and values can be mapped!");
+
+    using HeaderT = detail::HashMapImageHeader;
+
+    void *Image = nullptr;
+    size_t ImageSize = 0;
+    const BucketT *Buckets = nullptr;
+    unsigned NumBuckets = 0;
+    unsigned NumEntries = 0;
+
+public:
+    using size_type = unsigned;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = BucketT;
+    using const_iterator = HashMapIterator<KeyT, ValueT, KeyInfoT, BucketT,
+                                           true, ProbeT::HasOccupancyBitmap>;
+    using iterator = const_iterator;
+
+    MappedHashMap() = default;
+
+    MappedHashMap(MappedHashMap &&other) { swap(other); }
+
+    MappedHashMap &operator=(MappedHashMap &&other) {
+        close();
+        swap(other);
+        return *this;
+    }
+
+    MappedHashMap(const MappedHashMap &) = delete;
+    MappedHashMap &operator=(const MappedHashMap &) = delete;
+
+    ~MappedHashMap() { close(); }
+
+    void swap(MappedHashMap &RHS) {
+        std::swap(Image, RHS.Image);
+        std::swap(ImageSize, RHS.ImageSize);
+        std::swap(Buckets, RHS.Buckets);
+        std::swap(NumBuckets, RHS.NumBuckets);
+        std::swap(NumEntries, RHS.NumEntries);
+    }
+
+    /// open - Map the image at \p Path, replacing any image mapped before.
+    /// Returns false, leaving the map empty, if the file can't be mapped or
+    /// wasn't written from a map of this type.
+    bool open(const char *Path) {
+        close();
+        const int FD = ::open(Path, O_RDONLY);
+        if (FD < 0) return false;
+        struct stat St;
+        void *P = MAP_FAILED;
+        if (::fstat(FD, &St) == 0 && size_t(St.st_size) >= sizeof(HeaderT))
+            P = ::mmap(nullptr, St.st_size, PROT_READ, MAP_SHARED, FD, 0);
+        ::close(FD);  // The mapping keeps the file open.
+        if (P == MAP_FAILED) return false;
+        Image = P;
+        ImageSize = St.st_size;
+
+        HeaderT Header;
+        std::memcpy(&Header, Image, sizeof(Header));
+        if (!isCompatible(Header)) {
+            close();
+            return false;
+        }
+        Buckets = reinterpret_cast<const BucketT *>(
+            static_cast<const char *>(Image) + Header.BucketsOffset);
+        NumBuckets = Header.NumBuckets;
+        NumEntries = Header.NumEntries;
+        return true;
+    }
+
+    /// close - Unmap the image. The map is empty afterwards.
+    void close() {
+        if (Image) ::munmap(Image, ImageSize);
+        Image = nullptr;
+        ImageSize = 0;
+        Buckets = nullptr;
+        NumBuckets = 0;
+        NumEntries = 0;
+    }
+
+    bool isOpen() const { return Image != nullptr; }
+
+    bool empty() const { return NumEntries == 0; }
+    unsigned size() const { return NumEntries; }
+    unsigned getNumBuckets() const { return NumBuckets; }
+
+    const_iterator begin() const {
+        if (empty()) return end();
+        return const_iterator(Buckets, getBucketsend());
+    }
+    const_iterator end() const {
+        return const_iterator(getBucketsend(), getBucketsend(), true);
+    }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    size_type count(const KeyT &Val) const {
+        const BucketT *the_bucket_;
+        return LookupBucketFor(Val, the_bucket_) ? 1 : 0;
+    }
+
+    const_iterator find(const KeyT &Val) const { return find_as(Val); }
+
+    /// Alternate version of find() which allows a different, and possibly
+    /// less expensive, key type.
+    template <class LookupKeyT>
+    const_iterator find_as(const LookupKeyT &Val) const {
+        const BucketT *the_bucket_;
+        if (LookupBucketFor(Val, the_bucket_))
+            return const_iterator(the_bucket_, getBucketsend(), true);
+        return end();
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    ValueT lookup(const KeyT &Val) const {
+        const BucketT *the_bucket_;
+        if (LookupBucketFor(Val, the_bucket_)) return the_bucket_->GetSecond();
+        return ValueT();
+    }
+
+private:
+    const BucketT *getBucketsend() const { return Buckets + NumBuckets; }
+
+    const uint8_t *getMetadata() const {
+        return reinterpret_cast<const uint8_t *>(getBucketsend());
+    }
+
+    bool isCompatible(const HeaderT &Header) const {
+        if (std::memcmp(Header.Magic, HeaderT::getMagic(),
+                        sizeof(Header.Magic)) != 0 ||
+            Header.Version != HeaderT::CurrentVersion ||
+            Header.ByteOrder != HeaderT::ByteOrderMark)
+            return false;
+        if ((Header.NumBuckets & (Header.NumBuckets - 1)) != 0 ||
+            Header.NumEntries > Header.NumBuckets)
+            return false;
+        const HeaderT Expected =
+            HeaderT::template get<KeyT, ValueT, KeyInfoT, BucketT, ProbeT>(
+                Header.NumBuckets, Header.NumEntries);
+        return Header.BucketSize == Expected.BucketSize &&
+               Header.BucketAlign == Expected.BucketAlign &&
+               Header.KeySize == Expected.KeySize &&
+               Header.ValueSize == Expected.ValueSize &&
+               Header.MetadataSize == Expected.MetadataSize &&
+               Header.EmptyKeyHash == Expected.EmptyKeyHash &&
+               Header.BucketsOffset == Expected.BucketsOffset &&
+               Header.ImageSize == Expected.ImageSize &&
+               Header.ImageSize == ImageSize;
+    }
+
+    template <typename LookupKeyT>
+    bool LookupBucketFor(const LookupKeyT &Val,
+                         const BucketT *&FoundBucket) const {
+        if (NumBuckets == 0) {
+            FoundBucket = nullptr;
+            return false;
+        }
+        return ProbeT::template LookupBucketFor<KeyInfoT>(
+            Buckets, getMetadata(), NumBuckets, Val,
+            KeyInfoT::GetHashValue(Val), FoundBucket);
+    }
+};
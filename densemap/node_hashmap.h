@@ -0,0 +1,398 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "densemap/hashmap.h"
+
+namespace detail {
+
+/// NodePool - Hands out storage for single objects of type T from slabs that
+/// hold 8, 16, ... up to 1024 of them. Freed objects go on a free list that
+/// later allocations take from first; slabs are only returned by reset() and
+/// the destructor, which don't destroy the objects still in them.
+template <typename T>
+class NodePool {
+    union Slot {
+        Slot *Next;  // While on the free list.
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+    };
+
+    static constexpr size_t MinSlabSize = 8;
+    static constexpr size_t MaxSlabSize = 1024;
+
+    std::vector<std::pair<Slot *, size_t>> Slabs;
+    Slot *FreeList = nullptr;
+    Slot *Cur = nullptr;  // Next never used slot of the newest slab.
+    Slot *End = nullptr;
+    size_t NumSlots = 0;
+
+public:
+    NodePool() = default;
+    NodePool(const NodePool &) = delete;
+    NodePool &operator=(const NodePool &) = delete;
+    ~NodePool() { reset(); }
+
+    /// Return uninitialized storage for one T.
+    T *allocate() {
+        Slot *S = FreeList;
+        if (S) {
+            FreeList = S->Next;
+        } else {
+            if (Cur == End) NewSlab();
+            S = Cur++;
+        }
+        return reinterpret_cast<T *>(&S->Storage);
+    }
+
+    /// Give back the storage of a T from allocate(), already destroyed.
+    void deallocate(T *P) {
+        Slot *S = reinterpret_cast<Slot *>(P);
+        S->Next = FreeList;
+        FreeList = S;
+    }
+
+    /// Free every slab.
+    void reset() {
+        std::allocator<Slot> Alloc;
+        for (const std::pair<Slot *, size_t> &Slab : Slabs)
+            Alloc.deallocate(Slab.first, Slab.second);
+        Slabs.clear();
+        FreeList = Cur = End = nullptr;
+        NumSlots = 0;
+    }
+
+    void swap(NodePool &RHS) {
+        Slabs.swap(RHS.Slabs);
+        std::swap(FreeList, RHS.FreeList);
+        std::swap(Cur, RHS.Cur);
+        std::swap(End, RHS.End);
+        std::swap(NumSlots, RHS.NumSlots);
+    }
+
+    /// Return the size in bytes of all slabs, used or not.
+    size_t getMemorySize() const { return NumSlots * sizeof(Slot); }
+
+private:
+    void NewSlab() {
+        const size_t N =
+            Slabs.empty() ? MinSlabSize
+                          : std::min(Slabs.back().second * 2,
+                                     size_t(MaxSlabSize));
+        Cur = std::allocator<Slot>().allocate(N);
+        End = Cur + N;
+        Slabs.emplace_back(Cur, N);
+        NumSlots += N;
+    }
+};
+
+}  // end namespace detail
+
+/// NodeHashMap - A HashMap whose values live in nodes of their own instead
+/// of in the bucket array. Each bucket holds a key and a pointer to the
+/// node with the entry, so growing or compacting the table moves only those
+/// small buckets, never the values, and a reference to an entry stays valid
+/// until the entry is erased, whatever is inserted meanwhile. This suits
+/// large values, or values that must keep their address; for small ones a
+/// HashMap is faster, as every lookup that hits follows one more pointer.
+///
+/// A node holds a copy of the key next to the value, so an entry can be
+/// reached through a single pointer and iterated as a HashMapPair, while
+/// probing compares the keys in the buckets without touching the nodes.
+/// Nodes come from a per-map pool of slabs, which reuses the nodes of erased
+/// entries and is freed by clear().
+///
+/// The bucket array is a HashMap of any probing policy, hash width and key
+/// info, and the map offers the same interface as HashMapBase. Iterators
+/// yield a reference to the node; they are invalidated as HashMap's are.
+template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
+          typename ProbeT = QuadraticProbing>
+class NodeHashMap {
+    template <typename T>
+    using const_arg_type_t = typename const_pointer_or_const_ref<T>::type;
+
+    using NodeT = detail::HashMapPair<KeyT, ValueT>;
+    using IndexT = HashMap<KeyT, NodeT *, KeyInfoT,
+                           detail::HashMapPair<KeyT, NodeT *>, ProbeT>;
+
+    template <bool IsConst>
+    class Iterator;
+
+    IndexT Index;
+    detail::NodePool<NodeT> Pool;
+
+public:
+    using size_type = typename IndexT::size_type;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = NodeT;
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /// Create a NodeHashMap in which \p InitialReserve entries can be
+    /// inserted without growing the bucket array.
+    explicit NodeHashMap(size_type InitialReserve = 0)
+        : Index(InitialReserve) {}
+
+    NodeHashMap(const NodeHashMap &other) : Index(other.size()) {
+        try {
+            for (const NodeT &N : other)
+                try_emplace(N.GetFirst(), N.GetSecond());
+        } catch (...) {
+            DestroyAll();
+            throw;
+        }
+    }
+
+    NodeHashMap(NodeHashMap &&other) { swap(other); }
+
+    template <typename InputIt>
+    NodeHashMap(const InputIt &I, const InputIt &E)
+        : NodeHashMap(std::distance(I, E)) {
+        insert(I, E);
+    }
+
+    ~NodeHashMap() { DestroyAll(); }
+
+    NodeHashMap &operator=(NodeHashMap other) {
+        swap(other);
+        return *this;
+    }
+
+    void swap(NodeHashMap &RHS) {
+        Index.swap(RHS.Index);
+        Pool.swap(RHS.Pool);
+    }
+
+    iterator begin() { return iterator(Index.begin()); }
+    iterator end() { return iterator(Index.end()); }
+    const_iterator begin() const { return const_iterator(Index.begin()); }
+    const_iterator end() const { return const_iterator(Index.end()); }
+
+    bool empty() const { return Index.empty(); }
+    size_type size() const { return Index.size(); }
+    size_type getNumBuckets() const { return Index.getNumBuckets(); }
+
+    /// Return the size in bytes of the bucket array, its metadata and the
+    /// node slabs.
+    size_t getMemorySize() const {
+        return Index.getMemorySize() + Pool.getMemorySize();
+    }
+
+    void reserve(size_type num_entries_) { Index.reserve(num_entries_); }
+
+    /// Destroy every entry and free the node slabs.
+    void clear() {
+        DestroyAll();
+        Index.clear();
+        Pool.reset();
+    }
+
+    /// compact - Rehash the bucket array in place, as HashMap::compact().
+    /// The nodes stay where they are.
+    void compact() { Index.compact(); }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    size_type count(const_arg_type_t<KeyT> Val) const {
+        return Index.count(Val);
+    }
+
+    iterator find(const_arg_type_t<KeyT> Val) {
+        return iterator(Index.find(Val));
+    }
+    const_iterator find(const_arg_type_t<KeyT> Val) const {
+        return const_iterator(Index.find(Val));
+    }
+
+    /// Alternate version of find() which allows a different, and possibly
+    /// less expensive, key type.
+    template <class LookupKeyT>
+    iterator find_as(const LookupKeyT &Val) {
+        return iterator(Index.find_as(Val));
+    }
+    template <class LookupKeyT>
+    const_iterator find_as(const LookupKeyT &Val) const {
+        return const_iterator(Index.find_as(Val));
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    ValueT lookup(const_arg_type_t<KeyT> Val) const {
+        typename IndexT::const_iterator I = Index.find(Val);
+        if (I != Index.end()) return I->GetSecond()->GetSecond();
+        return ValueT();
+    }
+
+    std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+        return try_emplace(KV.first, KV.second);
+    }
+
+    std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+        return try_emplace(std::move(KV.first), std::move(KV.second));
+    }
+
+    /// insert - Range insertion of pairs.
+    template <typename InputIt>
+    void insert(InputIt I, InputIt E) {
+        for (; I != E; ++I) insert(*I);
+    }
+
+    // Inserts key,value pair into the map if the key isn't already in the map.
+    // The value is constructed in-place if the key is not in the map, otherwise
+    // it is not moved. If constructing it throws, the map is left as it was.
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+        std::pair<typename IndexT::iterator, bool> Res =
+            Index.try_emplace(std::move(Key), nullptr);
+        if (Res.second) FillNode(Res.first, std::forward<Ts>(Args)...);
+        return std::make_pair(iterator(Res.first), Res.second);
+    }
+
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+        std::pair<typename IndexT::iterator, bool> Res =
+            Index.try_emplace(Key, nullptr);
+        if (Res.second) FillNode(Res.first, std::forward<Ts>(Args)...);
+        return std::make_pair(iterator(Res.first), Res.second);
+    }
+
+    value_type &FindAndConstruct(const KeyT &Key) {
+        return *try_emplace(Key).first;
+    }
+
+    ValueT &operator[](const KeyT &Key) { return FindAndConstruct(Key).second; }
+
+    value_type &FindAndConstruct(KeyT &&Key) {
+        return *try_emplace(std::move(Key)).first;
+    }
+
+    ValueT &operator[](KeyT &&Key) {
+        return FindAndConstruct(std::move(Key)).second;
+    }
+
+    bool erase(const KeyT &Val) {
+        typename IndexT::iterator I = Index.find(Val);
+        if (I == Index.end()) return false;  // not in map.
+
+        erase(iterator(I));
+        return true;
+    }
+    void erase(iterator I) {
+        NodeT *N = I.Ptr->GetSecond();
+        Index.erase(I.Ptr);
+        DeleteNode(N);
+    }
+
+    /// getStats - The statistics of the bucket array, as
+    /// HashMapBase::getStats().
+    HashMapStats getStats() const { return Index.getStats(); }
+
+    void resetStats() { Index.resetStats(); }
+
+private:
+    /// FillNode - Give the bucket \p I, just inserted with a null node, a
+    /// node of its own. If that throws, the bucket is erased again, so no
+    /// entry is left without a node.
+    template <typename... Ts>
+    void FillNode(typename IndexT::iterator I, Ts &&... Args) {
+        try {
+            I->GetSecond() = NewNode(I->GetFirst(), std::forward<Ts>(Args)...);
+        } catch (...) {
+            Index.erase(I);
+            throw;
+        }
+    }
+
+    template <typename... Ts>
+    NodeT *NewNode(const KeyT &Key, Ts &&... Args) {
+        NodeT *N = Pool.allocate();
+        try {
+            ::new (&N->GetFirst()) KeyT(Key);
+        } catch (...) {
+            Pool.deallocate(N);
+            throw;
+        }
+        try {
+            ::new (&N->GetSecond()) ValueT(std::forward<Ts>(Args)...);
+        } catch (...) {
+            N->GetFirst().~KeyT();
+            Pool.deallocate(N);
+            throw;
+        }
+        return N;
+    }
+
+    void DeleteNode(NodeT *N) {
+        N->GetSecond().~ValueT();
+        N->GetFirst().~KeyT();
+        Pool.deallocate(N);
+    }
+
+    /// Destroy every entry, leaving the nodes in the pool and dangling
+    /// pointers in the buckets.
+    void DestroyAll() {
+        if (std::is_trivially_destructible<NodeT>::value) return;
+        for (const typename IndexT::value_type &B : Index) {
+            B.GetSecond()->GetSecond().~ValueT();
+            B.GetSecond()->GetFirst().~KeyT();
+        }
+    }
+
+    template <bool IsConst>
+    class Iterator {
+        friend class NodeHashMap;
+        template <bool>
+        friend class Iterator;
+
+        using IndexIterator =
+            typename std::conditional<IsConst, typename IndexT::const_iterator,
+                                      typename IndexT::iterator>::type;
+
+        IndexIterator Ptr;
+
+        explicit Iterator(IndexIterator Ptr) : Ptr(Ptr) {}
+
+    public:
+        using difference_type = ptrdiff_t;
+        using value_type =
+            typename std::conditional<IsConst, const NodeT, NodeT>::type;
+        using pointer = value_type *;
+        using reference = value_type &;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+
+        template <bool IsConstSrc,
+                  typename = typename std::enable_if<!IsConstSrc &&
+                                                     IsConst>::type>
+        Iterator(const Iterator<IsConstSrc> &I) : Ptr(I.Ptr) {}
+
+        reference operator*() const { return *Ptr->GetSecond(); }
+        pointer operator->() const { return Ptr->GetSecond(); }
+
+        bool operator==(const Iterator<true> &RHS) const {
+            return Ptr == RHS.Ptr;
+        }
+        bool operator!=(const Iterator<true> &RHS) const {
+            return Ptr != RHS.Ptr;
+        }
+
+        Iterator &operator++() {  // Preincrement
+            ++Ptr;
+            return *this;
+        }
+        Iterator operator++(int) {  // Postincrement
+            Iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+    };
+};
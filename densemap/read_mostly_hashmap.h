@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+#include "common/epoch.h"
+#include "densemap/hashmap.h"
+
+/// ReadMostlyHashMap - A concurrent map for tables that are read constantly
+/// and written rarely. Readers take no lock and are wait-free: they pin the
+/// current epoch, load the published HashMap and probe it. Writers serialize
+/// on a mutex, apply their change to a private copy of the table, publish
+/// the copy with one atomic store, and retire the old table through an
+/// EpochManager, which frees it once the readers that were using it are
+/// done.
+///
+/// Every write copies the whole table, so a write costs O(size()). Use
+/// modify() to apply many changes for the price of one copy.
+template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
+          typename BucketT = detail::HashMapPair<KeyT, ValueT>,
+          typename ProbeT = QuadraticProbing>
+class ReadMostlyHashMap {
+    using MapT = HashMap<KeyT, ValueT, KeyInfoT, BucketT, ProbeT>;
+    using ReadGuard = EpochManager::ReadGuard;
+
+    std::atomic<MapT *> Current;
+    std::mutex WriteLock;
+    mutable EpochManager Epochs;
+
+public:
+    using size_type = unsigned;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+
+    explicit ReadMostlyHashMap(unsigned InitialReserve = 0)
+        : Current(new MapT(InitialReserve)) {}
+
+    /// No reader or writer may be active anymore.
+    ~ReadMostlyHashMap() { delete Current.load(std::memory_order_relaxed); }
+
+    ReadMostlyHashMap(const ReadMostlyHashMap &) = delete;
+    ReadMostlyHashMap &operator=(const ReadMostlyHashMap &) = delete;
+
+    size_type size() const {
+        ReadGuard Guard(Epochs);
+        return load()->size();
+    }
+
+    bool empty() const { return size() == 0; }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    size_type count(const KeyT &Key) const {
+        ReadGuard Guard(Epochs);
+        return load()->count(Key);
+    }
+
+    /// find - Copy the value of \p Key into \p Value and return true, or
+    /// return false if the key isn't in the map.
+    bool find(const KeyT &Key, ValueT &Value) const {
+        return read(Key, [&](const ValueT &V) { Value = V; });
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    ValueT lookup(const KeyT &Key) const {
+        ReadGuard Guard(Epochs);
+        return load()->lookup(Key);
+    }
+
+    /// read - Call \p Fn on the value of \p Key and return true, or return
+    /// false if the key isn't in the map. The value stays alive while \p Fn
+    /// runs, but must not be used after it returns.
+    template <typename FnT>
+    bool read(const KeyT &Key, FnT Fn) const {
+        ReadGuard Guard(Epochs);
+        const MapT &Map = *load();
+        auto I = Map.find(Key);
+        if (I == Map.end()) return false;
+        Fn(I->GetSecond());
+        return true;
+    }
+
+    // Inserts key,value pair into the map if the key isn't already in the map.
+    // Returns false and leaves the value alone if the key is already there.
+    bool insert(const std::pair<KeyT, ValueT> &KV) {
+        return try_emplace(KV.first, KV.second);
+    }
+
+    template <typename... Ts>
+    bool try_emplace(const KeyT &Key, Ts &&... Args) {
+        std::lock_guard<std::mutex> Lock(WriteLock);
+        if (load()->count(Key)) return false;
+        MapT *New = new MapT(*load());
+        New->try_emplace(Key, std::forward<Ts>(Args)...);
+        publish(New);
+        return true;
+    }
+
+    /// update - Publish a copy of the table in which \p Fn has been applied
+    /// to the value of \p Key. Returns false, without copying anything, if
+    /// the key isn't in the map.
+    template <typename FnT>
+    bool update(const KeyT &Key, FnT Fn) {
+        std::lock_guard<std::mutex> Lock(WriteLock);
+        if (!load()->count(Key)) return false;
+        MapT *New = new MapT(*load());
+        Fn(New->find(Key)->GetSecond());
+        publish(New);
+        return true;
+    }
+
+    bool erase(const KeyT &Key) {
+        std::lock_guard<std::mutex> Lock(WriteLock);
+        if (!load()->count(Key)) return false;
+        MapT *New = new MapT(*load());
+        New->erase(Key);
+        New->compact();
+        publish(New);
+        return true;
+    }
+
+    /// modify - Apply any number of changes at once: \p Fn gets a private
+    /// copy of the table, which is published when it returns.
+    template <typename FnT>
+    void modify(FnT Fn) {
+        std::lock_guard<std::mutex> Lock(WriteLock);
+        MapT *New = new MapT(*load());
+        Fn(*New);
+        publish(New);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> Lock(WriteLock);
+        publish(new MapT());
+    }
+
+private:
+    MapT *load() const { return Current.load(std::memory_order_seq_cst); }
+
+    /// Make \p New the table readers see and retire the previous one.
+    void publish(MapT *New) {
+        MapT *Old = Current.exchange(New, std::memory_order_seq_cst);
+        Epochs.retire(Old);
+    }
+};
@@ -0,0 +1,574 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "common/math_utils.h"
+#include "densemap/hashmap.h"
+#include "densemap/hashset.h"
+
+namespace detail {
+
+/// SplitHashMapRef - An entry of a SplitHashMap, whose key and value live in
+/// different arrays: references to both, under the names HashMapPair gives
+/// them.
+template <typename KeyT, typename ValueT>
+struct SplitHashMapRef {
+    const KeyT &first;
+    ValueT &second;
+
+    const KeyT &GetFirst() const { return first; }
+    ValueT &GetSecond() const { return second; }
+};
+
+}  // end namespace detail
+
+/// SplitHashMapIterator - Walks the key array of a SplitHashMap with a
+/// HashMapIterator and pairs each live key with its value. Dereferencing
+/// yields a SplitHashMapRef by value, so it->second and (*it).second work as
+/// with HashMap, but *it can't be bound to a value_type &.
+template <typename KeyT, typename ValueT, typename KeyInfoT,
+          bool IsConst = false>
+class SplitHashMapIterator {
+    template <typename, typename, typename, bool>
+    friend class SplitHashMapIterator;
+    template <typename, typename, typename, typename, typename>
+    friend class SplitHashMap;
+
+    using KeyBucketT = detail::HashSetPair<KeyT>;
+    using KeyIteratorT = HashMapIterator<KeyT, detail::HashSetEmpty, KeyInfoT,
+                                         KeyBucketT, IsConst>;
+    using MaybeConstValueT =
+        typename std::conditional<IsConst, const ValueT, ValueT>::type;
+
+    KeyIteratorT I;
+    const KeyBucketT *Keys = nullptr;
+    MaybeConstValueT *Values = nullptr;
+
+public:
+    using difference_type = ptrdiff_t;
+    using value_type = detail::SplitHashMapRef<KeyT, MaybeConstValueT>;
+    using reference = value_type;
+    using iterator_category = std::forward_iterator_tag;
+
+    /// pointer - Keeps the entry operator-> returns the address of alive.
+    class pointer {
+        value_type Ref;
+
+    public:
+        explicit pointer(const value_type &Ref) : Ref(Ref) {}
+        const value_type *operator->() const { return &Ref; }
+    };
+
+    SplitHashMapIterator() = default;
+
+    SplitHashMapIterator(const KeyIteratorT &I, const KeyBucketT *Keys,
+                         MaybeConstValueT *Values)
+        : I(I), Keys(Keys), Values(Values) {}
+
+    template <bool IsConstSrc,
+              typename = typename std::enable_if<!IsConstSrc && IsConst>::type>
+    SplitHashMapIterator(
+        const SplitHashMapIterator<KeyT, ValueT, KeyInfoT, IsConstSrc> &Src)
+        : I(Src.I), Keys(Src.Keys), Values(Src.Values) {}
+
+    reference operator*() const {
+        const KeyBucketT &B = *I;
+        return reference{B.GetFirst(), Values[&B - Keys]};
+    }
+    pointer operator->() const { return pointer(**this); }
+
+    template <bool IsConstRHS>
+    bool operator==(const SplitHashMapIterator<KeyT, ValueT, KeyInfoT,
+                                               IsConstRHS> &RHS) const {
+        return I == RHS.I;
+    }
+    template <bool IsConstRHS>
+    bool operator!=(const SplitHashMapIterator<KeyT, ValueT, KeyInfoT,
+                                               IsConstRHS> &RHS) const {
+        return I != RHS.I;
+    }
+
+    SplitHashMapIterator &operator++() {  // Preincrement
+        ++I;
+        return *this;
+    }
+    SplitHashMapIterator operator++(int) {  // Postincrement
+        SplitHashMapIterator tmp = *this;
+        ++*this;
+        return tmp;
+    }
+};
+
+/// SplitHashMap - A HashMap whose keys and values are kept in two parallel
+/// arrays instead of one array of pairs. A lookup only compares keys, so it
+/// probes the dense key array and touches the value array once, for the
+/// entry it finds: with small keys and large values, a probe sequence fits
+/// in a cache line or two instead of one per bucket. Under
+/// SwissGroupProbing, probes mostly read the one-byte key fingerprints.
+///
+/// The key array, with its probing metadata, is laid out as in HashMap, and
+/// growth, tombstones, compact() and iterator invalidation work as they do
+/// there. Iterators yield a SplitHashMapRef instead of a bucket reference.
+/// Both arrays come from AllocatorT, rebound to the key bucket and to
+/// ValueT.
+template <typename KeyT, typename ValueT, typename KeyInfoT = HashMapInfo<KeyT>,
+          typename ProbeT = QuadraticProbing,
+          typename AllocatorT = std::allocator<ValueT>>
+class SplitHashMap
+    : private detail::BucketAllocator<detail::HashSetPair<KeyT>, ProbeT,
+                                      AllocatorT> {
+    // A policy that moves entries would need every move mirrored in the
+    // value array.
+    static_assert(!ProbeT::MovesEntries,
+                  "SplitHashMap needs a policy that leaves tombstones!");
+
+    using KeyBucketT = detail::HashSetPair<KeyT>;
+    using AllocBaseT = detail::BucketAllocator<KeyBucketT, ProbeT, AllocatorT>;
+    using ValueAllocT = typename std::allocator_traits<
+        AllocatorT>::template rebind_alloc<ValueT>;
+    using ValueAllocTraits = std::allocator_traits<ValueAllocT>;
+    using HashWidth = detail::HashWidthTraits<KeyT, KeyInfoT>;
+    using HashT = typename HashWidth::HashT;
+
+public:
+    using size_type = typename HashWidth::SizeT;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = detail::SplitHashMapRef<KeyT, ValueT>;
+    using iterator = SplitHashMapIterator<KeyT, ValueT, KeyInfoT>;
+    using const_iterator = SplitHashMapIterator<KeyT, ValueT, KeyInfoT, true>;
+    using allocator_type = AllocatorT;
+
+private:
+    KeyBucketT *Keys = nullptr;
+    ValueT *Values = nullptr;
+    size_type NumBuckets = 0;
+    size_type NumEntries = 0;
+    size_type NumTombstones = 0;
+    uint8_t MaxTombstonePercent = 25;  // As in HashMap.
+
+public:
+    /// Create a SplitHashMap in which \p InitialReserve entries can be
+    /// inserted without growing it.
+    explicit SplitHashMap(size_type InitialReserve = 0) {
+        reserve(InitialReserve);
+    }
+
+    /// Same as above, taking both arrays from \p Alloc.
+    SplitHashMap(size_type InitialReserve, const AllocatorT &Alloc)
+        : AllocBaseT(Alloc) {
+        reserve(InitialReserve);
+    }
+
+    explicit SplitHashMap(const AllocatorT &Alloc) : SplitHashMap(0, Alloc) {}
+
+    SplitHashMap(const SplitHashMap &other)
+        : AllocBaseT(std::allocator_traits<AllocatorT>::
+                         select_on_container_copy_construction(
+                             other.get_allocator())) {
+        CopyFrom(other);
+    }
+
+    SplitHashMap(SplitHashMap &&other) : AllocBaseT(other.get_allocator()) {
+        swap(other);
+    }
+
+    template <typename InputIt>
+    SplitHashMap(const InputIt &I, const InputIt &E)
+        : SplitHashMap(std::distance(I, E)) {
+        insert(I, E);
+    }
+
+    ~SplitHashMap() { DestroyAll(); }
+
+    SplitHashMap &operator=(const SplitHashMap &other) {
+        if (&other != this) {
+            SplitHashMap Tmp(get_allocator());
+            Tmp.CopyFrom(other);
+            swap(Tmp);
+        }
+        return *this;
+    }
+
+    SplitHashMap &operator=(SplitHashMap &&other) {
+        SplitHashMap Tmp(std::move(other));
+        swap(Tmp);
+        return *this;
+    }
+
+    void swap(SplitHashMap &RHS) {
+        std::swap(Keys, RHS.Keys);
+        std::swap(Values, RHS.Values);
+        std::swap(NumBuckets, RHS.NumBuckets);
+        std::swap(NumEntries, RHS.NumEntries);
+        std::swap(NumTombstones, RHS.NumTombstones);
+        std::swap(MaxTombstonePercent, RHS.MaxTombstonePercent);
+        this->swapAllocator(RHS);
+    }
+
+    AllocatorT get_allocator() const { return this->getAllocator(); }
+
+    iterator begin() {
+        if (empty()) return end();
+        return MakeIterator(Keys, false);
+    }
+    iterator end() { return MakeIterator(getKeysEnd(), true); }
+    const_iterator begin() const {
+        if (empty()) return end();
+        return MakeConstIterator(Keys, false);
+    }
+    const_iterator end() const { return MakeConstIterator(getKeysEnd(), true); }
+
+    bool empty() const { return NumEntries == 0; }
+    size_type size() const { return NumEntries; }
+    size_type getNumBuckets() const { return NumBuckets; }
+
+    /// Return the size in bytes of the key array, its metadata and the value
+    /// array.
+    size_t getMemorySize() const {
+        if (NumBuckets == 0) return 0;
+        return size_t(NumBuckets) * (sizeof(KeyBucketT) + sizeof(ValueT)) +
+               ProbeT::getMetadataSize(NumBuckets);
+    }
+
+    void reserve(size_type NumEntries_) {
+        if (NumEntries_ == 0) return;
+        // Stay below 3/4 full, as HashMap does.
+        const size_type MinBuckets =
+            static_cast<size_type>(NextPowerOf2(NumEntries_ * 4 / 3 + 1));
+        if (MinBuckets > NumBuckets) Grow(MinBuckets);
+    }
+
+    void clear() {
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        for (size_type i = 0; i != NumBuckets; ++i) {
+            if (isLive(i)) Values[i].~ValueT();
+            Keys[i].GetFirst() = EmptyKey;
+        }
+        ProbeT::initMetadata(getMetadata(), NumBuckets);
+        NumEntries = 0;
+        NumTombstones = 0;
+    }
+
+    /// compact - Rehash the table in place, as HashMap::compact(): every
+    /// tombstone becomes an empty bucket, and no second pair of arrays is
+    /// allocated. Invalidates iterators.
+    void compact() {
+        if (NumTombstones != 0) rehashInPlace();
+    }
+
+    /// Insertions compact the table once tombstones occupy more than
+    /// \p Percent percent of its buckets, as in HashMap. 0 disables this.
+    void setMaxTombstonePercent(unsigned Percent) {
+        assert(Percent <= 100 && "Not a percentage!");
+        MaxTombstonePercent = Percent;
+    }
+
+    unsigned getMaxTombstonePercent() const { return MaxTombstonePercent; }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    size_type count(const KeyT &Val) const {
+        const KeyBucketT *the_bucket_;
+        return LookupBucketFor(Val, the_bucket_) ? 1 : 0;
+    }
+
+    iterator find(const KeyT &Val) { return find_as(Val); }
+    const_iterator find(const KeyT &Val) const { return find_as(Val); }
+
+    /// Alternate version of find() which allows a different, and possibly
+    /// less expensive, key type.
+    template <class LookupKeyT>
+    iterator find_as(const LookupKeyT &Val) {
+        const KeyBucketT *the_bucket_;
+        if (LookupBucketFor(Val, the_bucket_))
+            return MakeIterator(const_cast<KeyBucketT *>(the_bucket_), true);
+        return end();
+    }
+    template <class LookupKeyT>
+    const_iterator find_as(const LookupKeyT &Val) const {
+        const KeyBucketT *the_bucket_;
+        if (LookupBucketFor(Val, the_bucket_))
+            return MakeConstIterator(the_bucket_, true);
+        return end();
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    ValueT lookup(const KeyT &Val) const {
+        const KeyBucketT *the_bucket_;
+        if (LookupBucketFor(Val, the_bucket_))
+            return Values[the_bucket_ - Keys];
+        return ValueT();
+    }
+
+    // Inserts key,value pair into the map if the key isn't already in the map.
+    // If the key is already in the map, it returns false and doesn't update the
+    // value.
+    std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+        return try_emplace(KV.first, KV.second);
+    }
+    std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+        return try_emplace(std::move(KV.first), std::move(KV.second));
+    }
+
+    /// insert - Range insertion of pairs.
+    template <typename InputIt>
+    void insert(InputIt I, InputIt E) {
+        for (; I != E; ++I) insert(*I);
+    }
+
+    // Inserts key,value pair into the map if the key isn't already in the map.
+    // The value is constructed in-place if the key is not in the map, otherwise
+    // it is not moved.
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+        const HashT Hash = KeyInfoT::GetHashValue(Key);
+        KeyBucketT *the_bucket_;
+        if (LookupBucketFor(Key, Hash, the_bucket_))
+            return std::make_pair(MakeIterator(the_bucket_, true), false);
+        the_bucket_ = InsertIntoBucket(the_bucket_, Hash, std::move(Key),
+                                       std::forward<Ts>(Args)...);
+        return std::make_pair(MakeIterator(the_bucket_, true), true);
+    }
+    template <typename... Ts>
+    std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+        const HashT Hash = KeyInfoT::GetHashValue(Key);
+        KeyBucketT *the_bucket_;
+        if (LookupBucketFor(Key, Hash, the_bucket_))
+            return std::make_pair(MakeIterator(the_bucket_, true), false);
+        the_bucket_ = InsertIntoBucket(the_bucket_, Hash, Key,
+                                       std::forward<Ts>(Args)...);
+        return std::make_pair(MakeIterator(the_bucket_, true), true);
+    }
+
+    ValueT &operator[](const KeyT &Key) {
+        return try_emplace(Key).first->second;
+    }
+    ValueT &operator[](KeyT &&Key) {
+        return try_emplace(std::move(Key)).first->second;
+    }
+
+    bool erase(const KeyT &Val) {
+        const KeyBucketT *the_bucket_;
+        if (!LookupBucketFor(Val, the_bucket_)) return false;  // not in map.
+        eraseBucket(the_bucket_ - Keys);
+        return true;
+    }
+    void erase(iterator I) { eraseBucket(&*I.I - Keys); }
+
+private:
+    KeyBucketT *getKeysEnd() { return Keys + NumBuckets; }
+    const KeyBucketT *getKeysEnd() const { return Keys + NumBuckets; }
+
+    uint8_t *getMetadata() {
+        return reinterpret_cast<uint8_t *>(getKeysEnd());
+    }
+    const uint8_t *getMetadata() const {
+        return reinterpret_cast<const uint8_t *>(getKeysEnd());
+    }
+
+    iterator MakeIterator(KeyBucketT *B, bool NoAdvance) {
+        return iterator(
+            typename iterator::KeyIteratorT(B, getKeysEnd(), NoAdvance), Keys,
+            Values);
+    }
+    const_iterator MakeConstIterator(const KeyBucketT *B,
+                                     bool NoAdvance) const {
+        return const_iterator(
+            typename const_iterator::KeyIteratorT(B, getKeysEnd(), NoAdvance),
+            Keys, Values);
+    }
+
+    bool isLive(size_type i) const {
+        const KeyT &Key = Keys[i].GetFirst();
+        return !KeyInfoT::IsEqual(Key, KeyInfoT::GetEmptyKey()) &&
+               !KeyInfoT::IsEqual(Key, KeyInfoT::GetTombstoneKey());
+    }
+
+    template <typename LookupKeyT>
+    bool LookupBucketFor(const LookupKeyT &Val, HashT Hash,
+                         const KeyBucketT *&FoundBucket) const {
+        if (NumBuckets == 0) {
+            FoundBucket = nullptr;
+            return false;
+        }
+        return ProbeT::template LookupBucketFor<KeyInfoT>(
+            Keys, getMetadata(), NumBuckets, Val, Hash, FoundBucket);
+    }
+    template <typename LookupKeyT>
+    bool LookupBucketFor(const LookupKeyT &Val, HashT Hash,
+                         KeyBucketT *&FoundBucket) {
+        const KeyBucketT *ConstFoundBucket;
+        bool Result = const_cast<const SplitHashMap *>(this)->LookupBucketFor(
+            Val, Hash, ConstFoundBucket);
+        FoundBucket = const_cast<KeyBucketT *>(ConstFoundBucket);
+        return Result;
+    }
+    template <typename LookupKeyT>
+    bool LookupBucketFor(const LookupKeyT &Val,
+                         const KeyBucketT *&FoundBucket) const {
+        return LookupBucketFor(Val, KeyInfoT::GetHashValue(Val), FoundBucket);
+    }
+
+    template <typename KeyArg, typename... ValueArgs>
+    KeyBucketT *InsertIntoBucket(KeyBucketT *the_bucket_, HashT Hash,
+                                 KeyArg &&Key, ValueArgs &&... Values_) {
+        // Grow when 3/4 full. Rehash in place when fewer than 1/8 of the
+        // buckets are left empty because of tombstones, or when tombstones
+        // take up more than MaxTombstonePercent of them.
+        if ((NumEntries + 1) * 4 >= NumBuckets * 3) {
+            Grow(NumBuckets * 2);
+            LookupBucketFor(Key, Hash, the_bucket_);
+        } else if (NumBuckets - (NumEntries + 1 + NumTombstones) <=
+                       NumBuckets / 8 ||
+                   shouldCompact()) {
+            rehashInPlace();
+            LookupBucketFor(Key, Hash, the_bucket_);
+        }
+        assert(the_bucket_);
+
+        ++NumEntries;
+        if (!KeyInfoT::IsEqual(the_bucket_->GetFirst(),
+                               KeyInfoT::GetEmptyKey()))
+            --NumTombstones;
+        const size_type i = the_bucket_ - Keys;
+        the_bucket_->GetFirst() = std::forward<KeyArg>(Key);
+        ::new (&Values[i]) ValueT(std::forward<ValueArgs>(Values_)...);
+        ProbeT::setFull(getMetadata(), NumBuckets, i, Hash);
+        return the_bucket_;
+    }
+
+    void eraseBucket(size_type i) {
+        Values[i].~ValueT();
+        Keys[i].GetFirst() = KeyInfoT::GetTombstoneKey();
+        ProbeT::setDeleted(getMetadata(), NumBuckets, i);
+        --NumEntries;
+        ++NumTombstones;
+    }
+
+    bool shouldCompact() const {
+        return MaxTombstonePercent != 0 &&
+               uint64_t(NumTombstones) * 100 >
+                   uint64_t(NumBuckets) * MaxTombstonePercent;
+    }
+
+    void AllocateBuckets(size_type Num) {
+        NumBuckets = Num;
+        Keys = this->allocateBucketArray(Num);
+        ValueAllocT ValueAlloc(this->getAllocator());
+        Values = ValueAllocTraits::allocate(ValueAlloc, Num);
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        for (size_type i = 0; i != Num; ++i)
+            ::new (&Keys[i].GetFirst()) KeyT(EmptyKey);
+        ProbeT::initMetadata(getMetadata(), Num);
+    }
+
+    void DestroyAll() {
+        if (NumBuckets == 0) return;
+        for (size_type i = 0; i != NumBuckets; ++i) {
+            if (isLive(i)) Values[i].~ValueT();
+            Keys[i].GetFirst().~KeyT();
+        }
+        this->deallocateBucketArray(Keys, NumBuckets);
+        ValueAllocT ValueAlloc(this->getAllocator());
+        ValueAllocTraits::deallocate(ValueAlloc, Values, NumBuckets);
+    }
+
+    void CopyFrom(const SplitHashMap &other) {
+        MaxTombstonePercent = other.MaxTombstonePercent;
+        if (other.NumBuckets == 0) return;
+        AllocateBuckets(other.NumBuckets);
+        for (size_type i = 0; i != NumBuckets; ++i) {
+            Keys[i].GetFirst() = other.Keys[i].GetFirst();
+            if (other.isLive(i)) ::new (&Values[i]) ValueT(other.Values[i]);
+        }
+        std::copy(other.getMetadata(),
+                  other.getMetadata() + ProbeT::getMetadataSize(NumBuckets),
+                  getMetadata());
+        NumEntries = other.NumEntries;
+        NumTombstones = other.NumTombstones;
+    }
+
+    /// Grow - Move every entry into a new table of at least \p AtLeast
+    /// buckets, dropping the tombstones.
+    void Grow(size_type AtLeast) {
+        SplitHashMap Tmp(get_allocator());
+        Tmp.MaxTombstonePercent = MaxTombstonePercent;
+        Tmp.AllocateBuckets(std::max<size_type>(
+            64, static_cast<size_type>(NextPowerOf2(AtLeast - 1))));
+        for (size_type i = 0; i != NumBuckets; ++i) {
+            if (!isLive(i)) continue;
+            KeyT &Key = Keys[i].GetFirst();
+            const HashT Hash = KeyInfoT::GetHashValue(Key);
+            KeyBucketT *Dest = ProbeT::template FindEmptyBucket<KeyInfoT>(
+                Tmp.Keys, Tmp.getMetadata(), Tmp.NumBuckets, Hash);
+            const size_type j = Dest - Tmp.Keys;
+            Dest->GetFirst() = std::move(Key);
+            ::new (&Tmp.Values[j]) ValueT(std::move(Values[i]));
+            ProbeT::setFull(Tmp.getMetadata(), Tmp.NumBuckets, j, Hash);
+            Values[i].~ValueT();
+            Key = KeyInfoT::GetEmptyKey();
+        }
+        Tmp.NumEntries = NumEntries;
+        swap(Tmp);
+    }
+
+    /// rehashInPlace - Drop all tombstones and move every entry to where a
+    /// fresh table of the same size would put it, moving each key and its
+    /// value together. Works as HashMapBase::rehashInPlace(): pending
+    /// entries claim the first bucket on their probe sequence that is empty
+    /// or still pending, swapping with the pending entry found there.
+    void rehashInPlace() {
+        const KeyT EmptyKey = KeyInfoT::GetEmptyKey();
+        const KeyT TombstoneKey = KeyInfoT::GetTombstoneKey();
+
+        std::unique_ptr<uint64_t[]> Pending(
+            new uint64_t[(NumBuckets + 63) / 64]());
+        auto IsPending = [&](size_t i) {
+            return (Pending[i / 64] >> (i % 64)) & 1;
+        };
+        for (size_type i = 0; i != NumBuckets; ++i) {
+            const KeyT &Key = Keys[i].GetFirst();
+            if (KeyInfoT::IsEqual(Key, EmptyKey)) continue;
+            if (KeyInfoT::IsEqual(Key, TombstoneKey))
+                Keys[i].GetFirst() = EmptyKey;
+            else
+                Pending[i / 64] |= uint64_t(1) << (i % 64);
+        }
+        ProbeT::initMetadata(getMetadata(), NumBuckets);
+        NumTombstones = 0;
+
+        for (size_type i = 0; i != NumBuckets; ++i) {
+            while (IsPending(i)) {
+                const HashT Hash = KeyInfoT::GetHashValue(Keys[i].GetFirst());
+                const size_t Dest =
+                    ProbeT::FindBucketIf(NumBuckets, Hash, [&](size_t j) {
+                        return IsPending(j) ||
+                               KeyInfoT::IsEqual(Keys[j].GetFirst(), EmptyKey);
+                    });
+                if (Dest == i) {
+                    // Already in place.
+                } else if (!IsPending(Dest)) {
+                    Keys[Dest].GetFirst() = std::move(Keys[i].GetFirst());
+                    ::new (&Values[Dest]) ValueT(std::move(Values[i]));
+                    Values[i].~ValueT();
+                    Keys[i].GetFirst() = EmptyKey;
+                    Pending[i / 64] &= ~(uint64_t(1) << (i % 64));
+                } else {
+                    // Take over Dest and carry on with its entry.
+                    std::swap(Keys[i].GetFirst(), Keys[Dest].GetFirst());
+                    std::swap(Values[i], Values[Dest]);
+                }
+                Pending[Dest / 64] &= ~(uint64_t(1) << (Dest % 64));
+                ProbeT::setFull(getMetadata(), NumBuckets, Dest, Hash);
+            }
+        }
+    }
+};
@@ -0,0 +1,222 @@
+#pragma once
+#if __cplusplus < 201402L
+#error "StaticHashMap needs C++14 constexpr."
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "densemap/hashing.h"
+
+/// StaticString - A string key of a StaticHashMap: a pointer and a length
+/// that can be used in constant expressions. It converts implicitly from
+/// string literals and, at run time, from std::string and std::string_view,
+/// so lookups copy nothing. It doesn't own the characters.
+class StaticString {
+    const char *Data = nullptr;
+    size_t Length = 0;
+
+    static constexpr size_t getLength(const char *S) {
+        size_t Len = 0;
+        while (S[Len] != '\0') ++Len;
+        return Len;
+    }
+
+public:
+    constexpr StaticString() = default;
+    constexpr StaticString(const char *S) : Data(S), Length(getLength(S)) {}
+    constexpr StaticString(const char *S, size_t Len) : Data(S), Length(Len) {}
+    StaticString(const std::string &S) : Data(S.data()), Length(S.size()) {}
+#if __cplusplus >= 201703L
+    constexpr StaticString(std::string_view S)
+        : Data(S.data()), Length(S.size()) {}
+#endif
+
+    constexpr const char *data() const { return Data; }
+    constexpr size_t size() const { return Length; }
+
+    friend constexpr bool operator==(const StaticString &LHS,
+                                     const StaticString &RHS) {
+        if (LHS.Length != RHS.Length) return false;
+        for (size_t i = 0; i != LHS.Length; ++i)
+            if (LHS.Data[i] != RHS.Data[i]) return false;
+        return true;
+    }
+
+    friend constexpr bool operator!=(const StaticString &LHS,
+                                     const StaticString &RHS) {
+        return !(LHS == RHS);
+    }
+};
+
+/// StaticHashMapInfo - The constexpr counterpart of HashMapInfo: hashing and
+/// equality for the keys of a StaticHashMap. Provided for integers, enums
+/// and StaticString, using the hashing::detail::cx functions.
+template <typename T, typename Enable = void>
+struct StaticHashMapInfo {
+    static constexpr uint64_t GetHashValue(const T &Val);
+    static constexpr bool IsEqual(const T &LHS, const T &RHS);
+};
+
+template <typename T>
+struct StaticHashMapInfo<
+    T, typename std::enable_if<std::is_integral<T>::value ||
+                               std::is_enum<T>::value>::type> {
+    static constexpr uint64_t GetHashValue(const T &Val) {
+        return hashing::detail::cx::hash_integer_value(
+            static_cast<uint64_t>(Val), 0xff51afd7ed558ccdULL);
+    }
+    static constexpr bool IsEqual(const T &LHS, const T &RHS) {
+        return LHS == RHS;
+    }
+};
+
+template <>
+struct StaticHashMapInfo<StaticString> {
+    static constexpr uint64_t GetHashValue(const StaticString &Val) {
+        return hashing::detail::cx::hash_string(Val.data(), Val.size(),
+                                                0xff51afd7ed558ccdULL);
+    }
+    static constexpr bool IsEqual(const StaticString &LHS,
+                                  const StaticString &RHS) {
+        return LHS == RHS;
+    }
+};
+
+namespace detail {
+
+template <typename KeyT, typename ValueT>
+struct StaticHashMapEntry {
+    KeyT first;
+    ValueT second;
+
+    constexpr const KeyT &GetFirst() const { return first; }
+    constexpr const ValueT &GetSecond() const { return second; }
+};
+
+}  // end namespace detail
+
+/// StaticHashMap - An immutable map of \p N entries whose table is built by
+/// the compiler. Declare it constexpr and it lives in read-only data, with
+/// nothing to initialize at startup and no heap:
+///
+///   constexpr std::pair<StaticString, Opcode> OpcodeNames[] = {
+///       {"add", Opcode::Add}, {"sub", Opcode::Sub}, ...};
+///   constexpr auto Opcodes = makeStaticHashMap(OpcodeNames);
+///   Opcode Op = Opcodes.lookup(Token);
+///
+/// Up to LinearScanLimit entries are simply compared one after the other.
+/// Larger maps add a linear probing table of entry indices with at least
+/// twice as many slots as entries. Keys and values must be literal types
+/// with a default constructor; keys must be unique. A duplicate key throws
+/// std::invalid_argument, which makes it a compile error in a constexpr map.
+template <typename KeyT, typename ValueT, size_t N,
+          typename KeyInfoT = StaticHashMapInfo<KeyT>>
+class StaticHashMap {
+    static_assert(N > 0, "StaticHashMap needs at least one entry.");
+
+public:
+    using size_type = unsigned;
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = detail::StaticHashMapEntry<KeyT, ValueT>;
+    using const_iterator = const value_type *;
+    using iterator = const_iterator;
+
+    /// Maps this small are scanned instead of hashed.
+    static constexpr size_t LinearScanLimit = 8;
+
+private:
+    static constexpr bool UseLinearScan = N <= LinearScanLimit;
+
+    static constexpr size_t getTableSize() {
+        size_t Size = 1;
+        while (Size < 2 * N) Size *= 2;
+        return Size;
+    }
+
+    static constexpr size_t TableSize = UseLinearScan ? 1 : getTableSize();
+
+    using SlotT = typename std::conditional<(N < 0xFFFF), uint16_t,
+                                            uint32_t>::type;
+
+    value_type Entries[N];
+    /// Index + 1 of the entry in each slot, 0 for empty slots.
+    SlotT Slots[TableSize];
+
+public:
+    constexpr explicit StaticHashMap(const std::pair<KeyT, ValueT> (&Init)[N])
+        : Entries{}, Slots{} {
+        for (size_t i = 0; i != N; ++i) {
+            Entries[i].first = Init[i].first;
+            Entries[i].second = Init[i].second;
+            if (UseLinearScan) {
+                for (size_t j = 0; j != i; ++j)
+                    if (KeyInfoT::IsEqual(Entries[j].first, Entries[i].first))
+                        throw std::invalid_argument(
+                            "Duplicate key in StaticHashMap!");
+                continue;
+            }
+            if (LookupBucketFor(Init[i].first))
+                throw std::invalid_argument("Duplicate key in StaticHashMap!");
+            size_t Slot = KeyInfoT::GetHashValue(Init[i].first) &
+                          (TableSize - 1);
+            while (Slots[Slot] != 0) Slot = (Slot + 1) & (TableSize - 1);
+            Slots[Slot] = static_cast<SlotT>(i + 1);
+        }
+    }
+
+    constexpr unsigned size() const { return N; }
+    constexpr bool empty() const { return false; }
+
+    constexpr const_iterator begin() const { return Entries; }
+    constexpr const_iterator end() const { return Entries + N; }
+
+    /// Return 1 if the specified key is in the map, 0 otherwise.
+    constexpr size_type count(const KeyT &Val) const {
+        return LookupBucketFor(Val) ? 1 : 0;
+    }
+
+    constexpr const_iterator find(const KeyT &Val) const {
+        const value_type *B = LookupBucketFor(Val);
+        return B ? B : end();
+    }
+
+    /// lookup - Return the entry for the specified key, or a default
+    /// constructed value if no such entry exists.
+    constexpr ValueT lookup(const KeyT &Val) const {
+        const value_type *B = LookupBucketFor(Val);
+        return B ? B->second : ValueT();
+    }
+
+private:
+    constexpr const value_type *LookupBucketFor(const KeyT &Val) const {
+        if (UseLinearScan) {
+            for (size_t i = 0; i != N; ++i)
+                if (KeyInfoT::IsEqual(Entries[i].first, Val))
+                    return &Entries[i];
+            return nullptr;
+        }
+        size_t Slot = KeyInfoT::GetHashValue(Val) & (TableSize - 1);
+        while (Slots[Slot] != 0) {
+            const value_type &E = Entries[Slots[Slot] - 1];
+            if (KeyInfoT::IsEqual(E.first, Val)) return &E;
+            Slot = (Slot + 1) & (TableSize - 1);
+        }
+        return nullptr;
+    }
+};
+
+/// makeStaticHashMap - Build a StaticHashMap from an array of key/value
+/// pairs, deducing its type.
+template <typename KeyT, typename ValueT, size_t N>
+constexpr StaticHashMap<KeyT, ValueT, N> makeStaticHashMap(
+    const std::pair<KeyT, ValueT> (&Init)[N]) {
+    return StaticHashMap<KeyT, ValueT, N>(Init);
+}